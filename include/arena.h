@@ -0,0 +1,124 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// monotonic memory arena for short-lived plain data: allocation bumps a pointer,
+// memory is returned all at once by rewinding, chunks are kept for reuse, so a
+// warmed-up arena serves repeated work without touching the heap;
+// not thread safe, each thread uses its own arena (see local)
+class Arena {
+public:
+	// rewinds the arena to its state at construction when leaving the scope
+	class Scope {
+	public:
+		Scope (Arena &arena);
+		~Scope ();
+
+	private:
+		Arena &m_arena;
+		unsigned m_chunk;
+		std::size_t m_offset;
+	};
+
+	// constructors
+	Arena (const std::size_t chunkSize = 64*1024);
+	~Arena ();
+
+	// public member functions
+	void* allocate(const std::size_t bytes, const std::size_t alignment = 16);
+	template <typename T> T* allocate(const std::size_t n); // uninitialized, T must not need a destructor
+	void release(); // rewinds to empty
+	std::size_t capacity() const; // [bytes] held by the chunks
+
+	static Arena& local(); // arena of the calling thread
+
+private:
+	struct Chunk
+	{
+		char *data;
+		std::size_t size;
+	};
+
+	Arena (const Arena&);
+	Arena& operator= (const Arena&);
+
+	// data members
+	std::vector<Chunk> m_chunks;
+	unsigned m_current; // chunk in use
+	std::size_t m_offset; // [bytes] used in the current chunk
+	std::size_t m_chunkSize;
+};
+
+template <typename T>
+T* Arena::allocate(const std::size_t n)
+{
+	return static_cast<T*>(allocate(n*sizeof(T), alignof(T) > 16 ? alignof(T) : 16));
+}
+
+// standard allocator on an arena, the default instance uses the heap;
+// a container on an arena must not outlive the arena scope it was filled in,
+// so copies of it are made on the heap and assignments keep the target's memory
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+	typedef std::false_type propagate_on_container_copy_assignment;
+	typedef std::false_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+	template <typename U> struct rebind { typedef ArenaAllocator<U> other; };
+
+	// constructors
+	ArenaAllocator (Arena *arena = 0) : m_arena(arena) {};
+	template <typename U> ArenaAllocator (const ArenaAllocator<U> &other) : m_arena(other.arena()) {};
+
+	// public member functions
+	T* allocate(const std::size_t n);
+	void deallocate(T *p, const std::size_t n); // arena memory is returned when its scope ends
+	ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+	Arena* arena() const { return m_arena; }
+
+private:
+	// data members
+	Arena *m_arena; // null for the heap
+};
+
+template <typename T>
+T* ArenaAllocator<T>::allocate(const std::size_t n)
+{
+	if (m_arena != 0)
+	{
+		return m_arena->allocate<T>(n);
+	}
+	return static_cast<T*>(::operator new(n*sizeof(T)));
+}
+
+template <typename T>
+void ArenaAllocator<T>::deallocate(T *p, const std::size_t n)
+{
+	if (m_arena == 0)
+	{
+		::operator delete(p);
+	}
+}
+
+template <typename T, typename U>
+bool operator== (const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+	return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!= (const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+	return a.arena() != b.arena();
+}
+
+// line buffer of the readers on an arena
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> > ArenaString;
+
+#endif /* ARENA_H_ */
@@ -2,23 +2,28 @@
 #define DATAIO_H_
 
 #include <string>
-#include <dlib/gui_widgets.h>
+#include <fstream>
 #include "model.h"
+#include "sweep.h"
 
-using namespace dlib;
+// escapes quotes, backslashes and control characters for json string values
+std::string jsonEscape(const std::string &s);
+// formats a json number, null for NaN and infinity
+std::string jsonNumber(const double value);
 
+// readers parse into the given arena if any, e.g. the one of a batch job (see ArenaAllocator)
 class TextGridReader {
 public:
 	// constructors
-	TextGridReader (const std::string &textGridFile);
+	TextGridReader (const std::string &textGridFile, Arena *arena = 0);
 
 	// public member functions
-	BoundVector getBounds() const;
+	const BoundVector& getBounds() const;
 
 private:
 	// private member functions
 	void readFile(const std::string &textGridFile);
-	static bool checkDigits(const std::string &s);
+	static bool checkDigits(const ArenaString &s);
 
 	// data members
 	BoundVector m_bounds;
@@ -27,10 +32,10 @@ private:
 class PitchTierReader {
 public:
 	// constructors
-	PitchTierReader (const std::string &pitchTierFile);
+	PitchTierReader (const std::string &pitchTierFile, Arena *arena = 0);
 
 	// public member functions
-	TimeSignal getF0() const;
+	const TimeSignal& getF0() const;
 	std::string getFileName() const;
 
 private:
@@ -43,6 +48,38 @@ private:
 	std::string m_fileName;
 };
 
+class CsvReader {
+public:
+	// constructors
+	CsvReader (const std::string &csvFile);
+
+	// public member functions
+	Sample getOnset() const;
+	TargetVector getTargets() const;
+	BoundVector getBounds() const;
+
+private:
+	// private member functions
+	void readFile(const std::string &csvFile);
+
+	// data members
+	Sample m_onset;
+	TargetVector m_targets;
+};
+
+class TextGridWriter {
+public:
+	// constructors
+	TextGridWriter (const std::string &textGridFile) : m_file(textGridFile) {};
+
+	// public member functions
+	void writeBounds(const BoundVector &bounds, const double endTime) const;
+
+private:
+	// data members
+	std::string m_file;
+};
+
 class PitchTierWriter {
 public:
 	// constructors
@@ -76,104 +113,64 @@ public:
 
 	// public member functions
 	void writeTargets(const Sample &onset, const TargetVector &targets) const;
+	void writeTargets(const Sample &onset, const TargetVector &targets, const ParameterUncertainty &uncertainty) const; // standard errors and correlations in additional columns
 
 private:
 	// data members
 	std::string m_file;
 };
 
-struct SignalStat
+// outcome of a single optimization job
+struct JobResult
 {
-	double minTime;
-	double maxTime;
-	double minValue;
-	double maxValue;
+	std::string textGridFile;
+	std::string pitchTierFile;
+	bool success;
+	std::string error;
+	Sample onset;
+	TargetVector targets;
+	FitMetrics metrics;
+	ParameterUncertainty uncertainty; // no targets if not estimated
+	OptimizationReport report;
+	bool cached; // result taken from the result cache
+	double wall; // [s]
+	double cpu; // [s] of all threads
+
+	// solver settings
+	std::string mode; // global, online, reoptimize or sweep
+	ParameterSet parameters;
+	unsigned threads;
+	double timeBudget; // [s], 0.0 for no limit
+	unsigned warmStarts; // restarts seeded from stored solutions
+	std::string precision; // double, single or mixed
+
+	// sweep mode only
+	std::string sweepParameter;
+	std::vector<SweepPoint> sweep;
 };
 
-class PlotRegion : public zoomable_region
-{
+// one json object per line and job, file "-" is standard output
+class JsonLinesWriter {
 public:
-	PlotRegion (drawable_window& w);
-	~PlotRegion ();
+	// constructors
+	JsonLinesWriter (const std::string &jsonFile);
 
-	void setBounds(const BoundVector &bounds);
-	void setOrigF0(const TimeSignal &f0);
-	void setOptimalF0(const TimeSignal &f0);
-	void setTargets(const TargetVector &targets);
+	// public member functions
+	void writeResult(const JobResult &result);
+	void writeLine(const std::string &line); // preformatted result without line break, e.g. replayed from a journal
 
-private:
-    void draw (const canvas& c) const;
-    SignalStat analyzeSignal(const TimeSignal &f0) const;
+	static std::string format(const JobResult &result); // single line without line break
 
-    TimeSignal m_optF0;
-    TimeSignal m_origF0;
-    BoundVector m_bounds;
-    TargetVector m_targets;
+private:
+	// data members
+	std::ofstream m_fout;
+	std::ostream *m_out;
 };
 
-class MainWindow : public drawable_window
-{
+class ConsoleProgressWriter : public OptimizationObserver {
 public:
-	MainWindow();
-    ~MainWindow();
-
-private:
-
-    // Private helper methods
-    void noOptimizationPerformed();
-
-    // Event handlers
-    void onButtonTextGridOpen ();
-    void onButtonPitchTierOpen ();
-    void onButtonOptimize ();
-    void openTextGrid ( const std::string& fileName);
-    void openPitchTier ( const std::string& fileName);
-    void onReadyForOptimize ();
-    void optimize ();
-    ParameterSet readParameters();
-    void onSaveFileGesture (const std::string& fileName);
-    void onButtonSaveAsGesture();
-    void onSaveFileCsv (const std::string& fileName);
-    void onMenuSaveAsCsv();
-    void onSaveFilePitchTier (const std::string& fileName);
-    void onMenuSaveAsPitchTier();
-    void blockMainWindow();
-    void unblockMainWindow();
-    void onMenuFileQuit();
-    void onMenuFileHelp();
-    void onMenuFileAbout();
-    void on_window_resized();
-
-    // Member data
-    const rgb_pixel colorBlack;
-    const rgb_pixel colorWhite;
-    const rgb_pixel colorMix;
-    const rgb_pixel colorRed;
-    const rgb_pixel colorGray;
-
-    PlotRegion graph;
-    button btnLoadTextGrid;
-    button btnLoadPitchTier;
-    button btnOptimize;
-    button btnStoreGesture;
-    check_box selOnset;
-    menu_bar mbar;
-    named_rectangle recTargets;
-    named_rectangle recOptions;
-    named_rectangle recActions;
-    text_grid targetGrid;
-    text_grid searchGrid;
-    text_grid penaltyGrid;
-    widget_group searchSpaceGroup;
-    widget_group penaltyGroup;
-    tabbed_display tabs;
-    label lbOnset;
-
-    TargetVector m_optTarget;
-    Sample m_optOnset;
-    TimeSignal m_optF0;
-    TimeSignal m_origF0;
-    BoundVector m_bounds;
+	// public member functions
+	void onIncumbent(const double cost, const double onsetValue, const TargetVector &targets, const double elapsed);
 };
 
 #endif /* DATAIO_H_ */
@@ -0,0 +1,203 @@
+#ifndef GUI_H_
+#define GUI_H_
+
+#include <dlib/gui_widgets.h>
+#include "model.h"
+#include "dataio.h"
+
+using namespace dlib;
+
+struct SignalStat
+{
+	double minTime;
+	double maxTime;
+	double minValue;
+	double maxValue;
+};
+
+// decimated plot geometry: extent of all samples falling into one pixel column
+struct PlotColumn
+{
+	long x;
+	long yMin;
+	long yMax;
+	unsigned count;
+};
+
+class PlotRegion : public zoomable_region
+{
+public:
+	PlotRegion (drawable_window& w);
+	~PlotRegion ();
+
+	void setBounds(const BoundVector &bounds);
+	void setOrigF0(const TimeSignal &f0);
+	void setOptimalF0(const TimeSignal &f0);
+	void setTargets(const TargetVector &targets);
+	TargetVector getTargets() const;
+	BoundVector getBounds() const;
+
+	// called with the target index while a target is dragged and when dragging has finished
+	template <typename T>
+	void setTargetEditHandler(T& object, void (T::*eventHandler)(unsigned long))
+	{
+		auto_mutex M(m);
+		m_editHandler.set(object, eventHandler);
+	}
+	template <typename T>
+	void setTargetEditDoneHandler(T& object, void (T::*eventHandler)(unsigned long))
+	{
+		auto_mutex M(m);
+		m_editDoneHandler.set(object, eventHandler);
+	}
+
+	// called with the bound index when a syllable bound has been moved
+	template <typename T>
+	void setBoundEditDoneHandler(T& object, void (T::*eventHandler)(unsigned long))
+	{
+		auto_mutex M(m);
+		m_boundEditDoneHandler.set(object, eventHandler);
+	}
+
+private:
+    void draw (const canvas& c) const;
+    void on_view_changed ();
+    SignalStat analyzeSignal(const TimeSignal &f0) const;
+    SignalStat getScaler() const;
+    void updateScaler();
+    void decimate (const TimeSignal &f0, std::vector<PlotColumn> &columns) const;
+    void drawColumns (const canvas& c, const rectangle& area, const std::vector<PlotColumn> &columns, const double radius, const rgb_pixel color) const;
+    static bool isEarlier (const Sample &s, const double time);
+    double targetBegin(const unsigned i) const;
+
+    // target editing: drag = offset, shift+drag = slope, ctrl+drag = time constant;
+    // dragging a syllable bound moves it
+    void on_mouse_down (unsigned long btn, unsigned long state, long x, long y, bool is_double_click);
+    void on_mouse_move (unsigned long state, long x, long y);
+    void on_mouse_up (unsigned long btn, unsigned long state, long x, long y);
+
+    TimeSignal m_optF0;
+    TimeSignal m_origF0;
+    BoundVector m_bounds;
+    TargetVector m_targets;
+
+    member_function_pointer<unsigned long> m_editHandler;
+    member_function_pointer<unsigned long> m_editDoneHandler;
+    member_function_pointer<unsigned long> m_boundEditDoneHandler;
+    bool m_dragging;
+    bool m_draggingBound;
+    unsigned m_dragBound;
+    unsigned long m_dragState;
+    unsigned m_dragTarget;
+    PitchTarget m_dragStartTarget;
+    point m_dragStartPoint;
+
+    // cached scaling and geometry, rebuilt when data, size or view changes
+    SignalStat m_scaler;
+    unsigned long m_dataVersion;
+    mutable unsigned long m_cachedVersion;
+    mutable rectangle m_cachedRect;
+    mutable std::vector<PlotColumn> m_origColumns;
+    mutable std::vector<PlotColumn> m_optColumns;
+};
+
+class MainWindow : public drawable_window, public OptimizationObserver
+{
+public:
+	MainWindow();
+    ~MainWindow();
+
+    // optimization progress, called by the worker thread
+    void onIncumbent(const double cost, const double onsetValue, const TargetVector &targets, const double elapsed);
+    void onRestart(const unsigned completed, const unsigned total, const double bestCost, const double elapsed);
+    bool stopRequested();
+
+private:
+
+    // Private helper methods
+    void noOptimizationPerformed();
+
+    // Event handlers
+    void onButtonTextGridOpen ();
+    void onButtonPitchTierOpen ();
+    void onButtonOptimize ();
+    void onButtonCancel ();
+    void onTargetEdited (unsigned long index);
+    void onTargetEditDone (unsigned long index);
+    void onBoundEditDone (unsigned long index);
+    void onMenuReoptimizeBounds ();
+    void startOptimization ();
+    void runOptimization ();
+    void onProgressTimer ();
+    void openTextGrid ( const std::string& fileName);
+    void openPitchTier ( const std::string& fileName);
+    void onReadyForOptimize ();
+    void optimize ();
+    ParameterSet readParameters();
+    void onSaveFileGesture (const std::string& fileName);
+    void onButtonSaveAsGesture();
+    void onSaveFileCsv (const std::string& fileName);
+    void onMenuSaveAsCsv();
+    void onSaveFilePitchTier (const std::string& fileName);
+    void onMenuSaveAsPitchTier();
+    void blockMainWindow();
+    void unblockMainWindow();
+    void onMenuFileQuit();
+    void onMenuFileHelp();
+    void onMenuFileAbout();
+    void on_window_resized();
+
+    // Member data
+    const rgb_pixel colorBlack;
+    const rgb_pixel colorWhite;
+    const rgb_pixel colorMix;
+    const rgb_pixel colorRed;
+    const rgb_pixel colorGray;
+
+    PlotRegion graph;
+    button btnLoadTextGrid;
+    button btnLoadPitchTier;
+    button btnOptimize;
+    button btnStoreGesture;
+    button btnCancel;
+    menu_bar mbar;
+    named_rectangle recTargets;
+    named_rectangle recOptions;
+    named_rectangle recActions;
+    text_grid targetGrid;
+    text_grid searchGrid;
+    text_grid penaltyGrid;
+    widget_group searchSpaceGroup;
+    widget_group penaltyGroup;
+    tabbed_display tabs;
+    check_box selOnset;
+    label lbOnset;
+    label lbProgress;
+
+    TargetVector m_optTarget;
+    Sample m_optOnset;
+    TimeSignal m_optF0;
+    TimeSignal m_origF0;
+    BoundVector m_bounds;
+
+    // model f0 for interactive target editing
+    dlib::scoped_ptr<IncrementalModelF0> m_model;
+
+    // background optimization, local re-optimization if free targets are given
+    ParameterSet m_parameters;
+    std::vector<unsigned> m_freeTargets;
+    std::vector<unsigned> m_changedBounds; // re-optimization around changed bounds
+    BoundVector m_solutionBounds; // bounds of current solution
+    dlib::scoped_ptr<thread_function> m_worker;
+    dlib::timer<MainWindow> m_progressTimer;
+    dlib::timestamper m_clock;
+    dlib::mutex m_progressMutex; // guards the following progress data
+    bool m_busy;
+    bool m_cancelRequested;
+    unsigned m_restartsCompleted;
+    unsigned m_restartsTotal;
+    double m_bestCost;
+    dlib::uint64 m_startTime;
+};
+
+#endif /* GUI_H_ */
@@ -0,0 +1,46 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <string>
+#include <map>
+#include <dlib/threads.h>
+#include <dlib/misc_api.h>
+#include <dlib/timer.h>
+
+// append-only progress journal of a batch run, so an interrupted run can resume:
+// one record per line, each appended with a single write; a timer syncs written
+// records to disk within the sync interval, a torn last record is dropped when reopening
+class BatchJournal {
+public:
+	// constructors
+	BatchJournal (const std::string &journalFile, const double syncInterval = 5.0); // [s], 0 syncs every record, loads existing records
+	~BatchJournal ();
+
+	// public member functions
+	bool finished(const std::string &job, std::string &result) const; // result recorded by markFinished
+	unsigned attempts(const std::string &job) const; // started, but not finished
+	void markStarted(const std::string &job);
+	void markFinished(const std::string &job, const std::string &result); // result must be a single line
+	void sync();
+
+	// job identity, independent of its position in the job list
+	static std::string makeKey(const std::string &textGridFile, const std::string &pitchTierFile);
+
+private:
+	// private member functions
+	void load();
+	void append(const std::string &record);
+	void onSyncTimer();
+
+	// data members
+	std::string m_file;
+	int m_fd;
+	double m_syncInterval;
+	bool m_dirty; // written since last sync
+	std::map<std::string,std::string> m_finished;
+	std::map<std::string,unsigned> m_attempts;
+	mutable dlib::mutex m_mutex;
+	dlib::timer<BatchJournal> m_syncTimer;
+};
+
+#endif /* JOURNAL_H_ */
@@ -4,8 +4,12 @@
 #include <cstdlib>
 #include <time.h>
 #include <vector>
+#include <map>
+#include <deque>
 #include <dlib/matrix.h>
 #include <dlib/error.h>
+#include <dlib/rand.h>
+#include "arena.h"
 
 // sample of a discrete time signal
 struct Sample
@@ -14,9 +18,9 @@ struct Sample
 	double value;
 };
 
-// discrete time signal types
+// discrete time signal types, signals of a batch job may live on its arena
 typedef std::vector<double> SampleTimes;
-typedef std::vector<Sample> TimeSignal;
+typedef std::vector<Sample, ArenaAllocator<Sample> > TimeSignal;
 
 // pitch target according to the TAM
 struct PitchTarget
@@ -30,8 +34,23 @@ struct PitchTarget
 // vector of pitch targets
 typedef std::vector<PitchTarget> TargetVector;
 
-// vector of syllable bounds
-typedef std::vector<double> BoundVector;
+// vector of syllable bounds, may live on the arena of a batch job
+typedef std::vector<double, ArenaAllocator<double> > BoundVector;
+
+// arithmetic of the cost function kernels
+enum Precision
+{
+	DOUBLE_PRECISION,
+	SINGLE_PRECISION,	// float kernels, ill-conditioned syllables fall back to double
+	MIXED_PRECISION		// optimizer only: restarts in single precision, best candidates polished in double
+};
+
+// filter implementations for model f0 calculation
+enum FilterEngine
+{
+	CLOSED_FORM,	// CdlpFilter
+	STATE_SPACE		// CdlpStateSpace
+};
 
 class TamModelF0 {
 public:
@@ -41,43 +60,127 @@ public:
 	// public member functions
 	void setOnsetValue(const double &onsetVal);
 	void setPitchTargets(const TargetVector &targets);
-	TimeSignal calculateF0(const double samplingPeriod) const;
+	void setFilterEngine(const FilterEngine engine);
+	TimeSignal calculateF0(const double samplingPeriod, Arena *arena = 0) const; // on the arena if any
 	TimeSignal calculateF0(const SampleTimes &times) const;
+	TimeSignal calculateF0(const SampleTimes &times, const double samplingPeriod, Arena *arena = 0) const; // times on a grid (gaps allowed)
 
 	TargetVector getPitchTargets() const;
 	Sample getOnset() const;
 
+	// period of the grid the sample times lie on, 0.0 if not uniformly sampled
+	static double gridPeriod(const SampleTimes &times);
+
 private:
 	// private member functions
-	void applyFilter(TimeSignal &f0, const SampleTimes &times) const;
+	void applyFilter(TimeSignal &f0, const SampleTimes &times, const double samplingPeriod = 0.0) const;
 
 	// data members
 	Sample m_onset;
 	TargetVector m_targets;
+	FilterEngine m_engine;
 };
 
 // vector types for CdlpFilter
 typedef std::vector<double> FilterState;
 typedef std::vector<double> FilterCoefficients;
 
+// default order of the target approximation filter, the precomputed sample layout and the batch kernels use it
+const unsigned FILTER_ORDER = 5;
+// default max. number of recurrence steps on a uniform grid before exact re-evaluation
+const unsigned RESYNC_INTERVAL = 32;
+
 // Nth order critical damped low pass filter for target approximation
 class CdlpFilter {
 public:
 	// constructors
-	CdlpFilter (const unsigned order=5) : m_filterOrder(order) {};
+	CdlpFilter (const unsigned order=FILTER_ORDER, const unsigned resyncInterval=RESYNC_INTERVAL) : m_filterOrder(order), m_resyncInterval(resyncInterval) {};
 
 	// public member functions
 	void response (TimeSignal &f0, const SampleTimes &sampleTimes, const TargetVector &targets, const Sample onset) const;
-
-private:
-	// private member functions
+	void responseUniform (TimeSignal &f0, const SampleTimes &sampleTimes, const double samplingPeriod, const TargetVector &targets, const Sample onset) const;
 	FilterCoefficients calculateCoefficients (const PitchTarget &target, const FilterState &state) const;
+	void calculateCoefficients (const PitchTarget &target, const double *state, double *coeffs) const; // arrays of filter order
 	FilterState calculateState (const FilterState &state, const double time, const double startTime, const PitchTarget &target) const;
+	void calculateState (const double *coeffs, const double time, const double startTime, const PitchTarget &target, double *state) const; // from the coefficients of the segment
 	static double binomial (const unsigned n, const unsigned k);
 	static double factorial (unsigned n);
 
+private:
+	// private member functions
+	static double horner (const FilterCoefficients &c, const double t);
+
 	// data members
 	unsigned m_filterOrder;
+	unsigned m_resyncInterval; // max. number of recurrence steps on a uniform grid before exact re-evaluation
+};
+
+// exactly discretized transition matrix (row major, upper triangular)
+typedef std::vector<double> TransitionMatrix;
+
+// Nth order critical damped low pass filter in discrete state space form:
+// the state holds the coefficients of the deviation from the target re-centered
+// at the current time, i.e. y(t+s) = exp(-s/tau)*sum_n(q_n*s^n) + slope*(t+s) + offset
+class CdlpStateSpace {
+public:
+	// constructors
+	CdlpStateSpace (const unsigned order=FILTER_ORDER) : m_filterOrder(order), m_filter(order), m_time(0.0), m_lastMatrix(0) {};
+	CdlpStateSpace (const CdlpStateSpace &other);
+
+	// operators
+	CdlpStateSpace& operator= (const CdlpStateSpace &other);
+
+	// public member functions
+	void response (TimeSignal &f0, const SampleTimes &sampleTimes, const TargetVector &targets, const Sample onset);
+	void response (TimeSignal &f0, const SampleTimes &sampleTimes, const TargetVector &targets, const double startTime, const FilterState &state);
+	void reset (const PitchTarget &target, const FilterState &state);
+	void setTarget (const PitchTarget &target);
+	double advance (const double dt);
+	double getValue () const;
+	FilterState getState () const;
+
+private:
+	// private member functions
+	const TransitionMatrix& transition (const double tau, const double dt);
+
+	// data members
+	unsigned m_filterOrder;
+	CdlpFilter m_filter;
+	PitchTarget m_target;
+	FilterState m_q;	// state vector
+	double m_time;		// time since begin of current target
+
+	// transition matrices per (tau, dt) pair
+	std::map<std::pair<double,double>, TransitionMatrix> m_cache;
+	std::pair<double,double> m_lastKey;
+	const TransitionMatrix* m_lastMatrix; // into m_cache, not copied
+};
+
+// model f0 on a uniform time grid, recalculated incrementally from cached filter states at
+// the syllable bounds when a single target changes
+class IncrementalModelF0 {
+public:
+	// constructors
+	IncrementalModelF0 (const BoundVector &bounds, const double samplingPeriod);
+
+	// public member functions
+	void setModel (const double onsetVal, const TargetVector &targets);
+	void setPitchTarget (const unsigned index, const PitchTarget &target);
+	TimeSignal getF0 () const;
+	TargetVector getPitchTargets () const;
+	Sample getOnset () const;
+
+private:
+	// private member functions
+	void update (const unsigned first);
+
+	// data members
+	BoundVector m_bounds;
+	Sample m_onset;
+	TargetVector m_targets;
+	std::vector<SampleTimes> m_times; // sample times per syllable
+	std::vector<FilterState> m_states; // filter state at each bound
+	std::vector<TimeSignal> m_segments; // model f0 per syllable
 };
 
 // parameter set defining an optimisation problem
@@ -98,53 +201,245 @@ struct ParameterSet
 // dlib linear algebra column vector for optimization tasks
 typedef dlib::matrix<double,0,1> DlibVector;
 
+// parameter vectors of several candidates in structure of arrays layout,
+// parameters of target i of candidate k at index i*size+k
+struct CandidateBatch
+{
+	unsigned size; // number of candidates
+	std::vector<double> onset;
+	std::vector<double> slope;
+	std::vector<double> offset;
+	std::vector<double> tau;
+};
+
+// fit measures of the optimal model f0 compared to the original f0
+struct FitMetrics
+{
+	double rmse;
+	double correlation;
+	double maxError;
+	double squaredError; // sum of squared errors
+	double penaltySlope; // weighted, without lambda
+	double penaltyOffset;
+	double penaltyTau;
+	double penalty; // lambda * (sum of weighted penalties)
+	std::vector<double> syllableRmse;
+};
+
+// standard errors and correlations of a single target from the laplace approximation
+struct TargetUncertainty
+{
+	double slope;
+	double offset;
+	double tau;
+	double corrSlopeOffset;
+	double corrSlopeTau;
+	double corrOffsetTau;
+};
+
+// laplace approximation of the parameter posterior at the optimum, NaN if not identifiable
+struct ParameterUncertainty
+{
+	double onset; // standard error
+	std::vector<TargetUncertainty> targets;
+	double residualVariance; // estimated f0 noise variance
+	unsigned long evaluations; // model f0 evaluations
+};
+
+class Profiler;
+class RestartPool;
+
 // optimization problem for calculating pitch targets
 class OptimizationProblem {
 public:
 	// constructors
-	OptimizationProblem (const ParameterSet &parameters, const TimeSignal &originalF0, const BoundVector &bounds)
-		: m_parameters(parameters),  m_originalF0(originalF0), m_bounds(bounds), m_modelOptimalF0(bounds) {};
+	OptimizationProblem (const ParameterSet &parameters, const TimeSignal &originalF0, const BoundVector &bounds, Arena *arena = 0); // signals and tables on the arena if any
 
 	// public member functions
 	void setOptimum(const double onsetVal, const TargetVector &targets);
+	void setPrecision(const Precision precision); // DOUBLE_PRECISION or SINGLE_PRECISION
 
 	ParameterSet getParameters() const;
-	TimeSignal getModelF0() const;
+	TimeSignal getModelF0(const double samplingFrequency = 200.0) const; // on the arena of the problem
 	TargetVector getPitchTargets() const;
 	Sample getOnset() const;
 	double getCorrelationCoefficient() const;
 	double getRootMeanSquareError() const;
+	FitMetrics getFitMetrics() const;
+	ParameterUncertainty estimateUncertainty() const; // at the optimum
 
 	// operator called by optimizer
 	double operator() (const DlibVector& arg) const;
 
+	// costs of many candidates at once, sharing sample layout and time powers across candidates
+	std::vector<double> evaluateBatch(const CandidateBatch &batch) const;
+	static CandidateBatch makeBatch(const std::vector<DlibVector> &candidates);
+
 private:
 	// private member functions
-	double costFunction(const TamModelF0 &tamF0) const;
+	void buildSampleLayout();
+	void evaluateLanes(const unsigned K, const double *onset, const double *slopes, const double *offsets, const double *taus, double *cost) const; // batch layout, scratch from the thread's arena
+	static bool singleConditioned(const unsigned K, const double *c, const double *a, const double tBegin, const double tEnd); // float kernel accurate for a syllable
+	void calculateFitMetrics();
 	static SampleTimes extractTimes(const TimeSignal &f0);
-	static DlibVector signal2dlibVec(const TimeSignal &f0);
 
 	// data members
 	ParameterSet m_parameters;
 	TimeSignal m_originalF0;
+	SampleTimes m_sampleTimes;
+	double m_samplingPeriod; // 0.0 if original f0 is not uniformly sampled
 	BoundVector m_bounds;
 
+	// sample layout fixed by the bounds, shared by all cost evaluations
+	std::vector<unsigned, ArenaAllocator<unsigned> > m_syllableStart; // first sample of each syllable, last entry ends the modelled samples
+	std::vector<double, ArenaAllocator<double> > m_powers; // powers 0..4 of the time relative to the syllable start, per sample
+	std::vector<double, ArenaAllocator<double> > m_values; // original f0 of the modelled samples
+	std::vector<char, ArenaAllocator<char> > m_exactDecay; // exponential evaluated exactly instead of advanced on the grid
+	Precision m_precision;
+	std::vector<float, ArenaAllocator<float> > m_powersSingle; // single precision copies, only if needed
+	std::vector<float, ArenaAllocator<float> > m_valuesSingle;
+
 	// store result
 	TamModelF0 m_modelOptimalF0;
+	TimeSignal m_optimalSamples; // optimal model f0 at original sample times
+	FitMetrics m_metrics;
+};
+
+// optimization problem for consecutive pitch targets starting from a known filter state
+class SegmentProblem {
+public:
+	// constructors
+	SegmentProblem (const ParameterSet &parameters, const TimeSignal &f0, const double startTime, const FilterState &state, const std::vector<double> &durations, const bool optimizeOnset);
+
+	// public member functions
+	unsigned numParameters() const;
+	TargetVector getPitchTargets(const DlibVector& arg) const;
+	FilterState getInitialState(const DlibVector& arg) const;
+
+	// operator called by optimizer
+	double operator() (const DlibVector& arg) const;
+
+private:
+	// data members
+	ParameterSet m_parameters;
+	TimeSignal m_f0;
+	SampleTimes m_sampleTimes;
+	double m_startTime;
+	FilterState m_state;
+	std::vector<double> m_durations;
+	bool m_optimizeOnset; // onset value is first parameter
+	mutable CdlpStateSpace m_lowPass; // keeps its transition cache across evaluations, so evaluations must not run concurrently
+};
+
+// online estimation of pitch targets from incrementally arriving f0 samples and syllable bounds,
+// a target is fixed once its syllable has ended and the lookahead [s] has elapsed
+class OnlineTargetEstimator {
+public:
+	// constructors
+	OnlineTargetEstimator (const ParameterSet &parameters, const double lookahead = 0.1, const unsigned randIters = 3);
+
+	// public member functions
+	void addSample (const Sample &s);
+	void addBound (const double time); // first bound is the onset time
+	void finish ();
+	bool hasTarget () const;
+	PitchTarget nextTarget ();
+	Sample getOnset () const;
+	FilterState getState () const; // filter state at begin of the pending syllable
+
+private:
+	// private member functions
+	void update (const bool final);
+	void estimate (const bool final);
+
+	// data members
+	ParameterSet m_parameters;
+	double m_lookahead;
+	unsigned m_randIters;
+	double m_currentTime;
+	bool m_started;
+	Sample m_onset;
+	FilterState m_state;
+	std::deque<Sample> m_samples; // samples of pending syllables
+	std::deque<double> m_bounds; // bounds of pending syllables
+	std::deque<PitchTarget> m_targets; // estimated, not yet fetched targets
+	dlib::rand m_random; // per instance, so estimators in different threads do not share state
+};
+
+// onset value and targets of a model f0, e.g. known solutions to start from
+struct ModelSolution
+{
+	double onset;
+	TargetVector targets;
+};
+
+// summary of an optimization run
+struct OptimizationReport
+{
+	double cost; // cost of the returned solution
+	unsigned restarts; // number of completed restarts
+	bool truncated; // stopped by time budget or observer, solution is best found so far
+	unsigned long evaluations; // cost function evaluations of all restarts
+	double helperCpu; // [s] of restarts run by threads other than the calling one
+};
+
+// receives intermediate results of an optimization run
+class OptimizationObserver {
+public:
+	virtual ~OptimizationObserver() {};
+
+	// called whenever the best solution so far has improved
+	virtual void onIncumbent(const double cost, const double onsetValue, const TargetVector &targets, const double elapsed) = 0;
+
+	// called after each restart
+	virtual void onRestart(const unsigned completed, const unsigned total, const double bestCost, const double elapsed) {};
+
+	// polled during optimization, returning true stops it with the best solution so far
+	virtual bool stopRequested() { return false; };
 };
 
 // solver for an optimization problem utilizing BOBYQA algorithm
 class BobyqaOptimizer {
 public:
 	// constructors
-	BobyqaOptimizer() { srand (time(NULL)); };
+	BobyqaOptimizer() : m_timeBudget(0.0), m_threads(1), m_restarts(0), m_precision(DOUBLE_PRECISION), m_observer(0), m_profiler(0), m_pool(0), m_random(time(NULL)) {};
 
 	// public member functions
-	void optimize(OptimizationProblem& op, const unsigned randIters = 10) const;
+	void setTimeBudget(const double seconds); // 0.0 for no limit
+	void setThreads(const unsigned threads); // number of threads running restarts in parallel
+	void setSeed(const unsigned long seed);
+	void setRestarts(const unsigned restarts); // 0 for default: randIters + 5 per target
+	void setInitialSolutions(const std::vector<ModelSolution> &solutions); // replace the first random starts
+	void setPrecision(const Precision precision); // of the restarts, the result of MIXED_PRECISION is polished in double
+	void setObserver(OptimizationObserver *observer);
+	void setProfiler(Profiler *profiler); // records restarts and phases if not null
+	void setPool(RestartPool *pool); // share restarts with idle threads of a batch instead of running threads of its own
+	OptimizationReport optimize(OptimizationProblem& op, const unsigned randIters = 10) const;
+	OptimizationReport optimizeLocal(OptimizationProblem& op, const std::vector<unsigned> &freeTargets, const unsigned randIters = 3) const;
+	OptimizationReport reoptimize(OptimizationProblem& op, const double onsetVal, const TargetVector &previous, const std::vector<unsigned> &changedBounds, const unsigned neighbourhood = 1, const bool polish = false) const;
+	OptimizationReport polish(OptimizationProblem& op) const;
+
+	// indices of bounds that differ between two segmentations of the same syllables
+	static std::vector<unsigned> findChangedBounds (const BoundVector &previous, const BoundVector &current, const double tolerance = 1e-6);
 
 private:
+	friend class RestartRunner;
+
 	// private member functions
-	static double getRandomValue (const double min, const double max);
+	double getRandomValue (const double min, const double max) const;
+	static TargetVector dlibVec2targets (const DlibVector &x, const TargetVector &durations);
+	static void searchSpace (const ParameterSet &ps, const unsigned numTar, DlibVector &lowerBound, DlibVector &upperBound);
+
+	// data members
+	double m_timeBudget; // [s]
+	unsigned m_threads;
+	unsigned m_restarts;
+	Precision m_precision;
+	std::vector<ModelSolution> m_initialSolutions;
+	OptimizationObserver *m_observer;
+	Profiler *m_profiler;
+	RestartPool *m_pool;
+	mutable dlib::rand m_random; // per instance, so optimizers in different threads do not share state
 };
 
 #endif /* MODEL_H_ */
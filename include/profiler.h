@@ -0,0 +1,89 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <dlib/threads.h>
+#include <dlib/misc_api.h>
+
+// outcome of a single optimization restart
+struct RestartRecord
+{
+	unsigned index;
+	unsigned thread; // set by the profiler
+	std::string job; // set by the profiler
+	unsigned long evaluations; // cost function evaluations
+	double cost;
+	double begin; // [s] since profiler creation
+	double wall; // [s]
+	double cpu; // [s] of the executing thread
+	std::string status; // converged, stopped or failure reason
+};
+
+// runtime instrumentation: phase timings, restart statistics and peak memory,
+// written as json report or chrome trace events (chrome://tracing);
+// jobs running side by side record through their own job profiler, so their records stay apart
+class Profiler {
+public:
+	// timed region, records nothing if profiler is null
+	class Scope {
+	public:
+		Scope (Profiler *profiler, const std::string &name);
+		~Scope ();
+		void close(); // record now instead of at destruction
+
+	private:
+		Profiler *m_profiler;
+		std::string m_name;
+		double m_begin;
+		double m_cpuBegin;
+	};
+
+	// constructors
+	Profiler ();
+	Profiler (Profiler &batch, const std::string &job); // records into batch, tagged with job
+
+	// public member functions
+	void addPhase(const std::string &name, const double begin, const double wall, const double cpu);
+	void addRestart(const RestartRecord &record);
+	void setLabel(const std::string &label);
+	double elapsed() const; // [s] since creation
+	unsigned long evaluations() const;
+	void writeReport(const std::string &jsonFile) const;
+	void writeTrace(const std::string &traceFile) const;
+
+	static double cpuTime(); // [s] of the calling thread
+	static long peakMemory(); // [kB] of the process
+
+private:
+	struct Event
+	{
+		std::string name;
+		std::string category;
+		std::string job;
+		unsigned thread;
+		double begin;
+		double wall;
+		double cpu;
+		std::string args; // json object
+	};
+
+	// private member functions
+	unsigned threadIndex();
+	void addPhase(const std::string &name, const std::string &job, const double begin, const double wall, const double cpu);
+	void addRestart(const RestartRecord &record, const std::string &job);
+
+	// data members
+	Profiler *m_batch; // null unless job profiler
+	std::string m_job;
+	dlib::timestamper m_ts;
+	dlib::uint64 m_start;
+	std::string m_label;
+	mutable dlib::mutex m_mutex;
+	std::map<dlib::thread_id_type, unsigned> m_threads;
+	std::vector<Event> m_events;
+	std::vector<RestartRecord> m_restarts;
+};
+
+#endif /* PROFILER_H_ */
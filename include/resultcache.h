@@ -0,0 +1,41 @@
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+
+#include <string>
+#include <dlib/threads.h>
+#include "model.h"
+
+// optimization result as kept in the cache
+struct CachedResult
+{
+	double cost;
+	ModelSolution solution;
+};
+
+// on-disk cache of optimization results, one file per result named by a hash of
+// the inputs (bounds, f0 samples, parameter set and solver settings);
+// least recently used files are evicted when the size limit is exceeded
+class ResultCache {
+public:
+	// constructors
+	ResultCache (const std::string &directory, const unsigned long long maxBytes = 0); // 0 for no size limit, creates directory if missing
+
+	// public member functions
+	bool lookup(const std::string &key, CachedResult &result) const; // marks entry as recently used
+	void store(const std::string &key, const CachedResult &result);
+
+	// content hash of an optimization problem, settings hold everything else affecting the result
+	static std::string makeKey(const BoundVector &bounds, const TimeSignal &f0, const ParameterSet &parameters, const std::string &settings);
+
+private:
+	// private member functions
+	std::string entryFile(const std::string &key) const;
+	void evict();
+
+	// data members
+	std::string m_directory;
+	unsigned long long m_maxBytes;
+	dlib::mutex m_mutex;
+};
+
+#endif /* RESULTCACHE_H_ */
@@ -0,0 +1,77 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <vector>
+#include <dlib/threads.h>
+#include "model.h"
+
+// restarts of one optimization that other threads may take over
+class RestartSource {
+public:
+	virtual ~RestartSource() {};
+	virtual bool claim(unsigned &it) = 0; // reserves the next restart, false if none is left
+	virtual void run(long it) = 0;
+	virtual void release() = 0; // claimed restart finished
+	virtual unsigned unclaimed() const = 0;
+};
+
+// restarts of concurrently running optimizations, idle threads help the
+// optimization with most unclaimed restarts instead of waiting for it
+class RestartPool {
+public:
+	// constructors
+	RestartPool ();
+
+	// public member functions
+	void add(RestartSource *source);
+	void remove(RestartSource *source); // no restarts are claimed from source afterwards
+	bool help(); // runs one restart, waits while none is available, false once closed
+	void close(); // wakes all helpers, help returns false when nothing is left
+
+private:
+	// data members
+	std::vector<RestartSource*> m_sources;
+	bool m_closed;
+	dlib::mutex m_mutex;
+	dlib::signaler m_available;
+};
+
+// jobs of a batch, called from several threads
+class BatchJobs {
+public:
+	virtual ~BatchJobs() {};
+	virtual void runJob(const unsigned index) = 0; // must not throw
+};
+
+// runs batch jobs on a fixed number of workers, largest estimated cost first;
+// workers without a job left help running jobs through the restart pool
+class BatchScheduler {
+public:
+	// constructors
+	BatchScheduler (const unsigned threads);
+
+	// public member functions
+	RestartPool& pool(); // pass to optimizers of the jobs
+	void run(const std::vector<double> &costs, BatchJobs &jobs); // relative cost of each job
+
+	// relative runtime of a global optimization with default restarts, from the input file sizes [bytes]
+	static double estimateCost(const dlib::uint64 textGridSize, const dlib::uint64 pitchTierSize);
+	static std::vector<unsigned> largestFirst(const std::vector<double> &costs);
+
+private:
+	friend class SchedulerWorker;
+
+	// private member functions
+	void work();
+
+	// data members
+	unsigned m_threads;
+	RestartPool m_pool;
+	std::vector<unsigned> m_order;
+	BatchJobs *m_jobs;
+	unsigned m_next; // next job in order
+	unsigned m_running; // jobs started but not finished
+	dlib::mutex m_mutex;
+};
+
+#endif /* SCHEDULER_H_ */
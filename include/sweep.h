@@ -0,0 +1,55 @@
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <string>
+#include <vector>
+#include "model.h"
+
+// result of a single grid point
+struct SweepPoint
+{
+	ParameterSet parameters;
+	ModelSolution solution;
+	FitMetrics metrics;
+	OptimizationReport report; // summed over full data and folds
+	double heldOutRmse; // cross-validated model f0 error at held-out syllables, infinity if no sample was held out
+};
+
+// hyperparameter sweep over a grid of parameter sets on a single utterance:
+// inputs are parsed once, each grid point is warm-started from its predecessor
+// and polished, contiguous parts of the grid run in parallel
+class ParameterSweep {
+public:
+	// constructors
+	ParameterSweep (const TimeSignal &f0, const BoundVector &bounds);
+
+	// public member functions
+	void setThreads(const unsigned threads); // number of grid parts solved in parallel
+	void setFolds(const unsigned folds); // syllable-level cross-validation folds, at least 2
+	void setRestarts(const unsigned restarts); // restarts of the global search at the start of each part, 0 for default
+	void setSeed(const unsigned long seed);
+	std::vector<SweepPoint> run(const std::vector<ParameterSet> &grid) const;
+
+	// copies of base with one parameter (lambda, m-weight, b-weight or t-weight) set to each value
+	static std::vector<ParameterSet> makeGrid(const ParameterSet &base, const std::string &parameter, const std::vector<double> &values);
+	// index of the point with the lowest held-out error, the first point if none could be scored
+	static unsigned selectBest(const std::vector<SweepPoint> &points);
+
+private:
+	friend class SweepRunner;
+
+	// private member functions
+	void solvePath(const std::vector<ParameterSet> &grid, const unsigned begin, const unsigned end, const unsigned long seed, std::vector<SweepPoint> &points) const;
+	double crossValidate(const ParameterSet &parameters, const ModelSolution &solution, const BobyqaOptimizer &optimizer, OptimizationReport &report) const;
+
+	// data members
+	TimeSignal m_f0;
+	BoundVector m_bounds;
+	std::vector<int> m_syllables; // syllable of each sample, -1 outside of bounds
+	unsigned m_threads;
+	unsigned m_folds;
+	unsigned m_restarts;
+	unsigned long m_seed;
+};
+
+#endif /* SWEEP_H_ */
@@ -0,0 +1,60 @@
+#ifndef SYNTHESIS_H_
+#define SYNTHESIS_H_
+
+#include <dlib/rand.h>
+#include "model.h"
+
+// value ranges and degradations of synthetic utterances
+struct CorpusSettings
+{
+	unsigned minSyllables;
+	unsigned maxSyllables;
+	double minDuration; // [s] per syllable
+	double maxDuration;
+	double leadIn; // [s] unsegmented time before the first syllable
+	double minBase; // [st] utterance mean pitch
+	double maxBase;
+	double slopeRange; // [st/s] slopes in +-slopeRange
+	double offsetRange; // [st] offsets in base +-offsetRange
+	double minTau; // [ms]
+	double maxTau;
+	double rate; // [Hz] f0 sampling rate
+	double noise; // [st] standard deviation of additive gaussian noise
+	double jitter; // fraction of the sampling period, sample times are displaced uniformly by +-jitter/2
+	double dropout; // probability of losing a single sample
+	double gapProbability; // probability of an unvoiced gap inside a syllable
+	double gapDuration; // [s] maximal duration of an unvoiced gap
+};
+
+// defaults: targets inside the default search space of the optimizer, clean f0 at 100 Hz
+CorpusSettings defaultCorpusSettings();
+
+// synthetic utterance with known targets
+struct SyntheticUtterance
+{
+	BoundVector bounds;
+	Sample onset;
+	TargetVector targets;
+	TimeSignal f0; // [st]
+};
+
+// random target sequences rendered with the target approximation model
+class CorpusGenerator {
+public:
+	// constructors
+	CorpusGenerator (const CorpusSettings &settings, const unsigned long seed);
+
+	// public member functions
+	SyntheticUtterance generate();
+	SyntheticUtterance generate(const unsigned syllables);
+
+private:
+	// private member functions
+	double uniform(const double min, const double max);
+
+	// data members
+	CorpusSettings m_settings;
+	dlib::rand m_random;
+};
+
+#endif /* SYNTHESIS_H_ */
@@ -0,0 +1,90 @@
+#ifndef TARGETOPTIMIZER_H_
+#define TARGETOPTIMIZER_H_
+
+/*
+ * C interface to the target optimizer for use from other programs in the same
+ * process. All arrays are owned by the caller. Handles are independent of each
+ * other and may be used concurrently from different threads, a single handle
+ * must not be used by two threads at the same time.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 2: to_metrics reports restarts and whether the time budget cut the optimization short */
+#define TO_API_VERSION 2
+
+/* return codes */
+#define TO_OK 0
+#define TO_ERROR_ARGUMENT 1 /* invalid or inconsistent input */
+#define TO_ERROR_STATE 2 /* result requested before optimization */
+#define TO_ERROR_OPTIMIZATION 3 /* optimization failed, see to_last_error */
+#define TO_ERROR_BUFFER 4 /* caller buffer too small */
+
+typedef struct to_problem to_problem; /* opaque handle */
+
+/* search space and regularization, values as in the command line tool */
+typedef struct {
+	double deltaSlope; /* [st/s] */
+	double deltaOffset; /* [st] */
+	double deltaTau; /* [ms] */
+	double weightSlope;
+	double weightOffset;
+	double weightTau;
+	double meanSlope;
+	double meanOffset;
+	double meanTau;
+	double lambda;
+} to_parameters;
+
+typedef struct {
+	double slope; /* [st/s] */
+	double offset; /* [st] */
+	double tau; /* [ms] */
+	double duration; /* [s] */
+} to_target;
+
+typedef struct {
+	double rmse;
+	double correlation;
+	double maxError;
+	double squaredError;
+	double penalty;
+	unsigned restarts; /* completed restarts */
+	int truncated; /* nonzero if stopped by the time budget, the result is the best found so far */
+} to_metrics;
+
+/* optimizer settings, zero means default */
+typedef struct {
+	unsigned threads; /* restarts run in parallel, 0 or 1 for sequential */
+	double timeBudget; /* [s], 0 for no limit */
+	unsigned long seed; /* 0 for time based seed */
+} to_settings;
+
+/* defaults of the command line tool, mean offset is the mean of the f0 values */
+void to_default_parameters(to_parameters *parameters, const double *f0Values, size_t numSamples);
+
+/* creates a problem from syllable bounds [s] and f0 samples (times [s], values [st]) */
+int to_create(const to_parameters *parameters, const double *bounds, size_t numBounds, const double *f0Times, const double *f0Values, size_t numSamples, to_problem **problem);
+void to_destroy(to_problem *problem);
+
+/* runs the global optimization, settings may be NULL */
+int to_optimize(to_problem *problem, const to_settings *settings);
+
+/* copies the optimal onset, targets (numBounds-1 entries) and metrics, any output may be NULL */
+int to_get_result(const to_problem *problem, double *onset, to_target *targets, size_t capacity, to_metrics *metrics);
+
+/* message of the last failure on this handle, empty if none */
+const char* to_last_error(const to_problem *problem);
+
+/* evaluates the model f0 [st] of given onset [st] and targets at the sample times [s], starting at time begin [s] */
+int to_evaluate_model(double begin, double onset, const to_target *targets, size_t numTargets, const double *times, double *values, size_t numSamples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TARGETOPTIMIZER_H_ */
@@ -0,0 +1,46 @@
+#ifndef WARMSTART_H_
+#define WARMSTART_H_
+
+#include <string>
+#include <vector>
+#include <dlib/threads.h>
+#include "model.h"
+
+// persistent library of converged solutions, keyed by speaker and context;
+// offsets are stored relative to the utterance mean f0 so solutions transfer
+// between utterances of a speaker; safe to share between threads
+class WarmStartStore {
+public:
+	// constructors
+	WarmStartStore (const std::string &storeFile, const unsigned maxEntries = 10000); // loads file if it exists
+
+	// public member functions
+	void addSolution(const std::string &speaker, const std::string &context, const double meanF0, const ModelSolution &solution);
+	std::vector<ModelSolution> findNearest(const std::string &speaker, const std::string &context, const double meanF0, const BoundVector &bounds, const unsigned count) const;
+	void save() const;
+	unsigned size() const;
+
+private:
+	struct Entry
+	{
+		std::string speaker;
+		std::string context;
+		double onset; // relative to mean f0
+		TargetVector targets; // offsets relative to mean f0
+	};
+
+	// private member functions
+	void load();
+	static std::vector<double> relativeDurations(const TargetVector &targets);
+	static double shapeDistance(const std::vector<double> &a, const std::vector<double> &b);
+	static ModelSolution mapToBounds(const Entry &entry, const double meanF0, const BoundVector &bounds);
+	static std::string sanitize(const std::string &key);
+
+	// data members
+	std::string m_file;
+	unsigned m_maxEntries;
+	std::vector<Entry> m_entries; // oldest first
+	mutable dlib::mutex m_mutex;
+};
+
+#endif /* WARMSTART_H_ */
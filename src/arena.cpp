@@ -0,0 +1,81 @@
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+#include "arena.h"
+
+Arena::Scope::Scope (Arena &arena)
+	: m_arena(arena), m_chunk(arena.m_current), m_offset(arena.m_offset)
+{
+}
+
+Arena::Scope::~Scope ()
+{
+	m_arena.m_current = m_chunk;
+	m_arena.m_offset = m_offset;
+}
+
+Arena::Arena (const std::size_t chunkSize)
+	: m_current(0), m_offset(0), m_chunkSize(chunkSize)
+{
+}
+
+Arena::~Arena ()
+{
+	for (unsigned i=0; i<m_chunks.size(); ++i)
+	{
+		std::free(m_chunks[i].data);
+	}
+}
+
+void* Arena::allocate(const std::size_t bytes, const std::size_t alignment)
+{
+	// first fit in the current or a later chunk, earlier chunks are still in use
+	for (unsigned i=m_current; i<m_chunks.size(); ++i)
+	{
+		const std::size_t offset = (i == m_current) ? m_offset : 0;
+		const std::size_t address = reinterpret_cast<std::size_t>(m_chunks[i].data) + offset;
+		const std::size_t aligned = offset + (alignment - address%alignment) % alignment;
+		if (aligned + bytes <= m_chunks[i].size)
+		{
+			m_current = i;
+			m_offset = aligned + bytes;
+			return m_chunks[i].data + aligned;
+		}
+	}
+
+	// oversized requests get a chunk of their own
+	Chunk chunk;
+	chunk.size = std::max(m_chunkSize, bytes + alignment);
+	chunk.data = static_cast<char*>(std::malloc(chunk.size));
+	if (chunk.data == 0)
+	{
+		throw std::bad_alloc();
+	}
+	m_chunks.push_back(chunk);
+	m_current = m_chunks.size()-1;
+	m_offset = 0;
+
+	return allocate(bytes, alignment);
+}
+
+void Arena::release()
+{
+	m_current = 0;
+	m_offset = 0;
+}
+
+std::size_t Arena::capacity() const
+{
+	std::size_t total (0);
+	for (unsigned i=0; i<m_chunks.size(); ++i)
+	{
+		total += m_chunks[i].size;
+	}
+	return total;
+}
+
+Arena& Arena::local()
+{
+	static thread_local Arena arena;
+	return arena;
+}
@@ -0,0 +1,333 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <dlib/cmd_line_parser.h>
+#include <dlib/misc_api.h>
+#include "model.h"
+#include "dataio.h"
+#include "synthesis.h"
+
+// synthetic utterance with known targets, rendered at a given sample rate
+struct Utterance
+{
+	BoundVector bounds;
+	TargetVector targets;
+	double onset;
+	TimeSignal f0;
+	SampleTimes times;
+};
+
+static Utterance makeUtterance (const unsigned syllables, const double rate, const unsigned long seed)
+{
+	CorpusSettings settings = defaultCorpusSettings();
+	settings.leadIn = 0.0;
+	settings.rate = rate;
+	CorpusGenerator generator (settings, seed);
+	SyntheticUtterance su = generator.generate(syllables);
+
+	Utterance u;
+	u.bounds = su.bounds;
+	u.targets = su.targets;
+	u.onset = su.onset.value;
+	u.f0 = su.f0;
+	for (unsigned k=0; k<u.f0.size(); ++k)
+	{
+		u.times.push_back(u.f0[k].time);
+	}
+	return u;
+}
+
+static ParameterSet defaultParameters (const TimeSignal &f0)
+{
+	// same defaults as the command line tool
+	double meanF0 = 0.0;
+	for (unsigned i=0; i<f0.size(); ++i)
+	{
+		meanF0 += f0[i].value;
+	}
+	meanF0 /= f0.size();
+
+	ParameterSet ps;
+	ps.deltaSlope = 50.0;
+	ps.deltaOffset = 20.0;
+	ps.deltaTau = 5.0;
+	ps.weightSlope = 10.0;
+	ps.weightOffset = 5.0;
+	ps.weightTau = 1.0;
+	ps.lambda = 0.0;
+	ps.meanSlope = 0.0;
+	ps.meanOffset = meanF0;
+	ps.meanTau = 15.0;
+	return ps;
+}
+
+// results are accumulated here so the compiler cannot drop the benchmarked calls
+static volatile double g_sink = 0.0;
+
+struct ResponseBench
+{
+	ResponseBench (const Utterance &u, const bool uniform, const double rate) : m_u(u), m_uniform(uniform), m_period(1.0/rate) {};
+	void operator() () const
+	{
+		TimeSignal f0;
+		Sample onset = {m_u.bounds[0], m_u.onset};
+		if (m_uniform)
+		{
+			m_filter.responseUniform(f0, m_u.times, m_period, m_u.targets, onset);
+		}
+		else
+		{
+			m_filter.response(f0, m_u.times, m_u.targets, onset);
+		}
+		g_sink += f0.back().value;
+	}
+	const Utterance &m_u;
+	bool m_uniform;
+	double m_period;
+	CdlpFilter m_filter;
+};
+
+struct CoefficientsBench
+{
+	CoefficientsBench (const Utterance &u) : m_u(u), m_state(FILTER_ORDER, 0.0) { m_state[0] = u.onset; m_state[1] = 12.0; };
+	void operator() () const
+	{
+		FilterCoefficients c = m_filter.calculateCoefficients(m_u.targets[0], m_state);
+		g_sink += c[FILTER_ORDER-1];
+	}
+	const Utterance &m_u;
+	FilterState m_state;
+	CdlpFilter m_filter;
+};
+
+struct StateBench
+{
+	StateBench (const Utterance &u) : m_u(u), m_state(FILTER_ORDER, 0.0) { m_state[0] = u.onset; m_state[1] = 12.0; };
+	void operator() () const
+	{
+		FilterState s = m_filter.calculateState(m_state, m_u.bounds[1], m_u.bounds[0], m_u.targets[0]);
+		g_sink += s[FILTER_ORDER-1];
+	}
+	const Utterance &m_u;
+	FilterState m_state;
+	CdlpFilter m_filter;
+};
+
+struct CostBench
+{
+	CostBench (const OptimizationProblem &op, const DlibVector &x) : m_op(op), m_x(x) {};
+	void operator() () const
+	{
+		g_sink += m_op(m_x);
+	}
+	const OptimizationProblem &m_op;
+	DlibVector m_x;
+};
+
+struct BatchCostBench
+{
+	BatchCostBench (const OptimizationProblem &op, const CandidateBatch &batch) : m_op(op), m_batch(batch) {};
+	void operator() () const
+	{
+		g_sink += m_op.evaluateBatch(m_batch)[0];
+	}
+	const OptimizationProblem &m_op;
+	CandidateBatch m_batch;
+};
+
+struct Measurement
+{
+	unsigned long iterations;
+	double nsPerOp;
+};
+
+// repeat the call until the minimal run time is reached
+template <typename T>
+Measurement measure (const T &bench, const double minTime)
+{
+	dlib::timestamper ts;
+	Measurement m = {0, 0.0};
+	bench();	// warm up
+
+	unsigned long batch (1);
+	const dlib::uint64 start = ts.get_timestamp();
+	dlib::uint64 elapsed (0);
+	while (elapsed < minTime*1e6)
+	{
+		for (unsigned long i=0; i<batch; ++i)
+		{
+			bench();
+		}
+		m.iterations += batch;
+		batch *= 2;
+		elapsed = ts.get_timestamp() - start;
+	}
+	m.nsPerOp = elapsed*1e3/m.iterations;
+	return m;
+}
+
+static void writeMicro (std::ostream &out, bool &first, const std::string &name, const unsigned syllables, const double rate, const Measurement &m)
+{
+	out << (first ? "\n" : ",\n");
+	out << "    {\"name\": \"" << name << "\", \"syllables\": " << syllables << ", \"rate\": " << jsonNumber(rate)
+		<< ", \"iterations\": " << m.iterations << ", \"ns_per_op\": " << jsonNumber(m.nsPerOp) << "}";
+	first = false;
+	std::cerr << name << "\tsyllables=" << syllables << "\trate=" << rate << "\tns/op=" << m.nsPerOp << std::endl;
+}
+
+static void runOptimization (std::ostream &out, bool &first, const unsigned syllables, const double rate, const unsigned threads, const double budget)
+{
+	Utterance u = makeUtterance(syllables, rate, 1000+syllables);
+	OptimizationProblem problem (defaultParameters(u.f0), u.f0, u.bounds);
+	BobyqaOptimizer optimizer;
+	optimizer.setSeed(1);
+	optimizer.setThreads(threads);
+	optimizer.setTimeBudget(budget);
+
+	dlib::timestamper ts;
+	const dlib::uint64 start = ts.get_timestamp();
+	OptimizationReport report = optimizer.optimize(problem);
+	const double seconds = (ts.get_timestamp() - start)/1e6;
+
+	out << (first ? "\n" : ",\n");
+	out << "    {\"syllables\": " << syllables << ", \"rate\": " << jsonNumber(rate) << ", \"samples\": " << u.f0.size()
+		<< ", \"threads\": " << threads << ", \"seconds\": " << jsonNumber(seconds) << ", \"restarts\": " << report.restarts
+		<< ", \"restarts_per_second\": " << jsonNumber(report.restarts/seconds) << ", \"truncated\": " << (report.truncated ? "true" : "false")
+		<< ", \"cost\": " << jsonNumber(report.cost) << ", \"rmse\": " << jsonNumber(problem.getFitMetrics().rmse) << "}";
+	first = false;
+	std::cerr << "optimize\tsyllables=" << syllables << "\trate=" << rate << "\tthreads=" << threads << "\ttime=" << seconds << "\trestarts=" << report.restarts << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// ********** command line parsing **********
+		dlib::command_line_parser parser;
+		parser.add_option("h","Display this help message.");
+		parser.add_option("o","Write JSON results to given file instead of standard output.",1);
+		parser.add_option("min-time","Specify minimal run time of each microbenchmark in s.",1);
+		parser.add_option("budget","Specify time budget of each end-to-end optimization in s.",1);
+		parser.add_option("max-threads","Specify largest thread count of the scaling runs.",1);
+		parser.add_option("quick","Run a reduced set of problem sizes.");
+		parser.parse(argc,argv);
+
+		const char* one_time_opts[] = {"h", "o", "min-time", "budget", "max-threads", "quick"};
+		parser.check_one_time_options(one_time_opts);
+		parser.check_option_arg_range("min-time", 0.001, 100.0);
+		parser.check_option_arg_range("budget", 0.0, 1e5);
+		parser.check_option_arg_range("max-threads", 1, 256);
+
+		if (parser.option("h"))
+		{
+			std::cout << "Usage: TargetOptimizerBench { <options> }\n";
+			parser.print_options();
+			return EXIT_SUCCESS;
+		}
+
+		const double minTime = get_option(parser,"min-time",0.2);
+		const double budget = get_option(parser,"budget",10.0);
+		const unsigned maxThreads = get_option(parser,"max-threads",8);
+		const bool quick = parser.option("quick");
+
+		std::ofstream fout;
+		if (parser.option("o"))
+		{
+			fout.open(parser.option("o").argument().c_str());
+			if (!fout.is_open())
+			{
+				throw dlib::error("[main] Cannot open output file!");
+			}
+		}
+		std::ostream &out = parser.option("o") ? fout : std::cout;
+
+		// problem sizes
+		const unsigned allSyllables[] = {2, 5, 10, 20, 50, 100};
+		const double allRates[] = {100.0, 200.0, 500.0, 1000.0};
+		const unsigned numSyllables = quick ? 3 : 6;
+		const unsigned numRates = quick ? 2 : 4;
+		const unsigned batchSize = 32; // candidates of the batched cost, reported per candidate
+
+		out << "{\n  \"format\": 1,\n  \"timestamp\": " << time(NULL) << ",\n  \"compiler\": \"" << __VERSION__ << "\",\n";
+
+		// ********** microbenchmarks **********
+		out << "  \"micro\": [";
+		bool first (true);
+		for (unsigned r=0; r<numRates; ++r)
+		{
+			Utterance u = makeUtterance(10, allRates[r], 1);
+			writeMicro(out, first, "CdlpFilter::response", 10, allRates[r], measure(ResponseBench(u, false, allRates[r]), minTime));
+			writeMicro(out, first, "CdlpFilter::responseUniform", 10, allRates[r], measure(ResponseBench(u, true, allRates[r]), minTime));
+		}
+
+		Utterance u = makeUtterance(2, 200.0, 1);
+		writeMicro(out, first, "CdlpFilter::calculateCoefficients", 1, 0.0, measure(CoefficientsBench(u), minTime));
+		writeMicro(out, first, "CdlpFilter::calculateState", 1, 0.0, measure(StateBench(u), minTime));
+
+		for (unsigned s=0; s<numSyllables; ++s)
+		{
+			for (unsigned r=0; r<numRates; ++r)
+			{
+				Utterance u = makeUtterance(allSyllables[s], allRates[r], 1);
+				OptimizationProblem problem (defaultParameters(u.f0), u.f0, u.bounds);
+				DlibVector x;
+				x.set_size(3*u.targets.size()+1);
+				x(0) = u.onset;
+				for (unsigned i=0; i<u.targets.size(); ++i)
+				{
+					x(3*i+1) = u.targets[i].slope;
+					x(3*i+2) = u.targets[i].offset;
+					x(3*i+3) = u.targets[i].tau;
+				}
+				writeMicro(out, first, "OptimizationProblem::operator()", allSyllables[s], allRates[r], measure(CostBench(problem, x), minTime));
+
+				// same cost per candidate, batches of perturbed candidates
+				dlib::rand rnd (1);
+				std::vector<DlibVector> candidates (batchSize, x);
+				for (unsigned k=1; k<batchSize; ++k)
+				{
+					for (long j=0; j<x.size(); ++j)
+					{
+						candidates[k](j) += 0.1*rnd.get_random_gaussian();
+					}
+				}
+				Measurement m = measure(BatchCostBench(problem, OptimizationProblem::makeBatch(candidates)), minTime);
+				m.nsPerOp /= batchSize;
+				writeMicro(out, first, "OptimizationProblem::evaluateBatch", allSyllables[s], allRates[r], m);
+			}
+		}
+		out << "\n  ],\n";
+
+		// ********** end-to-end optimization **********
+		out << "  \"end_to_end\": [";
+		first = true;
+		for (unsigned s=0; s<numSyllables; ++s)
+		{
+			for (unsigned r=0; r<numRates && r<3; ++r)
+			{
+				runOptimization(out, first, allSyllables[s], allRates[r], 1, budget);
+			}
+		}
+		out << "\n  ],\n";
+
+		// ********** thread scaling **********
+		out << "  \"thread_scaling\": [";
+		first = true;
+		for (unsigned threads=1; threads<=maxThreads; threads*=2)
+		{
+			runOptimization(out, first, 10, 200.0, threads, budget);
+		}
+		out << "\n  ]\n}\n";
+
+		std::cerr << "checksum " << g_sink << std::endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "[main] Program was terminated because an error occurred!\n" << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <time.h>
+#include <dlib/cmd_line_parser.h>
+#include "model.h"
+#include "dataio.h"
+#include "synthesis.h"
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// ********** command line parsing **********
+		dlib::command_line_parser parser;
+		parser.add_option("h","Display this help message.");
+		parser.set_group_name("Corpus Options");
+		parser.add_option("n","Specify number of utterances.",1);
+		parser.add_option("o","Specify existing output directory.",1);
+		parser.add_option("prefix","Specify file name prefix of the utterances.",1);
+		parser.add_option("seed","Specify random seed (default: time based).",1);
+		parser.set_group_name("Utterance Options");
+		parser.add_option("min-syllables","Specify minimal number of syllables per utterance.",1);
+		parser.add_option("max-syllables","Specify maximal number of syllables per utterance.",1);
+		parser.add_option("rate","Specify f0 sampling rate in Hz.",1);
+		parser.set_group_name("Degradation Options");
+		parser.add_option("noise","Specify standard deviation of additive f0 noise in st.",1);
+		parser.add_option("jitter","Specify displacement of sample times as fraction of the sampling period.",1);
+		parser.add_option("dropout","Specify probability of losing a single sample.",1);
+		parser.add_option("gaps","Specify probability of an unvoiced gap in a syllable.",1);
+		parser.add_option("gap-duration","Specify maximal duration of an unvoiced gap in s.",1);
+		parser.parse(argc,argv);
+
+		const char* one_time_opts[] = {"h", "n", "o", "prefix", "seed", "min-syllables", "max-syllables", "rate", "noise", "jitter", "dropout", "gaps", "gap-duration"};
+		parser.check_one_time_options(one_time_opts);
+		parser.check_option_arg_range("n", 1, 10000000);
+		parser.check_option_arg_range("min-syllables", 1, 10000);
+		parser.check_option_arg_range("max-syllables", 1, 10000);
+		parser.check_option_arg_range("rate", 1.0, 1e6);
+		parser.check_option_arg_range("noise", 0.0, 100.0);
+		parser.check_option_arg_range("jitter", 0.0, 0.99);
+		parser.check_option_arg_range("dropout", 0.0, 0.99);
+		parser.check_option_arg_range("gaps", 0.0, 1.0);
+		parser.check_option_arg_range("gap-duration", 0.0, 10.0);
+
+		if (parser.option("h"))
+		{
+			std::cout << "Usage: TargetOptimizerGenerate { <options> }\n";
+			std::cout << "Writes TextGrid/PitchTier pairs with ground truth targets (<name>-truth.csv),\n";
+			std::cout << "a job list (jobs.txt) and a list of truth/result pairs for scoring (truth.txt).\n";
+			parser.print_options();
+			return EXIT_SUCCESS;
+		}
+
+		CorpusSettings settings = defaultCorpusSettings();
+		settings.minSyllables = get_option(parser,"min-syllables",settings.minSyllables);
+		settings.maxSyllables = get_option(parser,"max-syllables",std::max(settings.maxSyllables, settings.minSyllables));
+		settings.rate = get_option(parser,"rate",settings.rate);
+		settings.noise = get_option(parser,"noise",settings.noise);
+		settings.jitter = get_option(parser,"jitter",settings.jitter);
+		settings.dropout = get_option(parser,"dropout",settings.dropout);
+		settings.gapProbability = get_option(parser,"gaps",settings.gapProbability);
+		settings.gapDuration = get_option(parser,"gap-duration",settings.gapDuration);
+
+		const unsigned count = get_option(parser,"n",10);
+		const std::string prefix = get_option(parser,"prefix",std::string("utt"));
+		std::string dir = get_option(parser,"o",std::string(""));
+		if (!dir.empty() && dir[dir.size()-1] != '/')
+		{
+			dir += "/";
+		}
+
+		CorpusGenerator generator (settings, get_option(parser,"seed",(unsigned long)time(NULL)));
+
+		std::ofstream jobs ((dir + "jobs.txt").c_str());
+		std::ofstream truth ((dir + "truth.txt").c_str());
+		if (!jobs.good() || !truth.good())
+		{
+			throw dlib::error("[main] Cannot create list files in output directory!");
+		}
+
+		for (unsigned n=0; n<count; ++n)
+		{
+			std::ostringstream name;
+			name << dir << prefix << std::setw(std::max(4, (int)std::log10((double)count)+1)) << std::setfill('0') << n+1;
+
+			SyntheticUtterance u = generator.generate();
+			if (u.f0.size() < 2)
+			{
+				throw dlib::error("[main] Too few voiced samples, reduce dropout or gaps!");
+			}
+
+			// PitchTier files hold f0 in Hz
+			TimeSignal f0Hz = u.f0;
+			for (unsigned k=0; k<f0Hz.size(); ++k)
+			{
+				f0Hz[k].value = std::pow(2.0, f0Hz[k].value/12.0);
+			}
+
+			TextGridWriter tgwriter (name.str() + ".TextGrid");
+			tgwriter.writeBounds(u.bounds, u.bounds.back() + settings.leadIn);
+			PitchTierWriter ptwriter (name.str() + ".PitchTier");
+			ptwriter.writeF0(f0Hz);
+			CsvWriter cwriter (name.str() + "-truth.csv");
+			cwriter.writeTargets(u.onset, u.targets);
+
+			// the optimizer writes <name>.csv with option -c
+			jobs << name.str() << ".TextGrid\t" << name.str() << ".PitchTier" << std::endl;
+			truth << name.str() << "-truth.csv\t" << name.str() << ".csv" << std::endl;
+		}
+
+		std::cout << "Generated " << count << " utterances." << std::endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "[main] Program was terminated because an error occurred!\n" << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,995 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <dlib/misc_api.h>
+#include "gui.h"
+
+PlotRegion::PlotRegion (drawable_window& w) : zoomable_region(w,MOUSE_CLICK | MOUSE_MOVE | MOUSE_WHEEL | KEYBOARD_EVENTS),
+	m_dragging(false), m_draggingBound(false), m_dragBound(0), m_dragState(0), m_dragTarget(0),
+	m_dataVersion(1), m_cachedVersion(0)
+{
+	SignalStat empty = {0,0,0,0};
+	m_scaler = empty;
+	enable_events();
+}
+
+PlotRegion::~PlotRegion ()
+{
+	disable_events();
+	parent.invalidate_rectangle(rect);
+}
+
+void PlotRegion::setBounds(const BoundVector &bounds)
+{
+	auto_mutex M(m);
+	m_bounds = bounds;
+	updateScaler();
+	parent.invalidate_rectangle(rect);
+};
+
+void PlotRegion::setOrigF0(const TimeSignal &f0)
+{
+	auto_mutex M(m);
+	m_origF0 = f0;
+	updateScaler();
+	parent.invalidate_rectangle(rect);
+}
+
+void PlotRegion::setOptimalF0(const TimeSignal &f0)
+{
+	auto_mutex M(m);
+	m_optF0 = f0;
+	m_dataVersion++;
+	parent.invalidate_rectangle(rect);
+}
+
+void PlotRegion::setTargets(const TargetVector &targets)
+{
+	auto_mutex M(m);
+	m_targets = targets;
+	parent.invalidate_rectangle(rect);
+}
+
+TargetVector PlotRegion::getTargets() const
+{
+	auto_mutex M(m);
+	return m_targets;
+}
+
+BoundVector PlotRegion::getBounds() const
+{
+	auto_mutex M(m);
+	return m_bounds;
+}
+
+SignalStat PlotRegion::getScaler() const
+{
+	return m_scaler;
+}
+
+void PlotRegion::updateScaler()
+{
+	// time axis from bounds, value axis from original f0
+	SignalStat scaler = {0,0,0,0};
+	if (!m_bounds.empty())
+	{
+		scaler.minTime = m_bounds[0]-0.1;
+		scaler.maxTime = m_bounds[m_bounds.size()-1]+0.1;
+	}
+	if (!m_origF0.empty())
+	{
+		SignalStat stat = analyzeSignal(m_origF0);
+		scaler.maxValue = stat.maxValue+5;
+		scaler.minValue = stat.minValue-5;
+		if (scaler.maxTime == 0.0)
+		{
+			scaler.maxTime = stat.maxTime;
+			scaler.minTime = stat.minTime;
+		}
+	}
+
+	m_scaler = scaler;
+	m_dataVersion++;
+}
+
+void PlotRegion::on_view_changed ()
+{
+	// geometry is rebuilt on next draw
+	m_dataVersion++;
+}
+
+bool PlotRegion::isEarlier (const Sample &s, const double time)
+{
+	return s.time < time;
+}
+
+void PlotRegion::decimate (const TimeSignal &f0, std::vector<PlotColumn> &columns) const
+{
+	columns.clear();
+	if (f0.empty())
+	{
+		return;
+	}
+
+	// visible time range
+	const SignalStat& sc = m_scaler;
+	const rectangle dr = display_rect();
+	double tLeft = sc.minTime + gui_to_graph_space(point(dr.left(),dr.top())).x()/width()*(sc.maxTime-sc.minTime);
+	double tRight = sc.minTime + gui_to_graph_space(point(dr.right(),dr.top())).x()/width()*(sc.maxTime-sc.minTime);
+	TimeSignal::const_iterator it = std::lower_bound(f0.begin(), f0.end(), tLeft, isEarlier);
+	if (it != f0.begin())
+	{
+		--it;
+	}
+
+	// min/max envelope per pixel column
+	for (; it != f0.end(); ++it)
+	{
+		vector<double,2> g (((it->time-sc.minTime)/(sc.maxTime-sc.minTime))*width(), ((it->value-sc.minValue)/(sc.maxValue-sc.minValue))*height());
+		point p = graph_to_gui_space(g);
+		if (!columns.empty() && columns.back().x == p.x())
+		{
+			PlotColumn& col = columns.back();
+			col.yMin = std::min(col.yMin, p.y());
+			col.yMax = std::max(col.yMax, p.y());
+			col.count++;
+		}
+		else
+		{
+			PlotColumn col = {p.x(), p.y(), p.y(), 1};
+			columns.push_back(col);
+		}
+
+		if (it->time > tRight)
+		{
+			break;
+		}
+	}
+}
+
+void PlotRegion::drawColumns (const canvas& c, const rectangle& area, const std::vector<PlotColumn> &columns, const double radius, const rgb_pixel color) const
+{
+	for (unsigned i=0; i<columns.size(); ++i)
+	{
+		const PlotColumn& col = columns[i];
+		draw_solid_circle(c, point(col.x, col.yMin), radius, color);
+		if (col.count > 1 && col.yMax != col.yMin)
+		{
+			draw_line(c, point(col.x, col.yMin), point(col.x, col.yMax), color, area);
+			draw_solid_circle(c, point(col.x, col.yMax), radius, color);
+		}
+	}
+}
+
+double PlotRegion::targetBegin(const unsigned i) const
+{
+	double begin = m_optF0.empty() ? m_bounds[0] : m_optF0[0].time;
+	for (unsigned j=0; j<i; ++j)
+	{
+		begin += m_targets[j].duration;
+	}
+
+	return begin;
+}
+
+void PlotRegion::on_mouse_down (unsigned long btn, unsigned long state, long x, long y, bool is_double_click)
+{
+	if (enabled && !hidden && btn == base_window::LEFT && display_rect().contains(x,y) && !m_targets.empty() && m_origF0.size() > 0)
+	{
+		// find target line next to mouse pointer
+		SignalStat sc = getScaler();
+		for (unsigned i=0; i<m_targets.size(); ++i)
+		{
+			double begin = targetBegin(i);
+			double end = begin + m_targets[i].duration;
+			point p1 = graph_to_gui_space(point(((begin-sc.minTime)/(sc.maxTime-sc.minTime))*width(), ((m_targets[i].offset-sc.minValue)/(sc.maxValue-sc.minValue))*height()));
+			point p2 = graph_to_gui_space(point(((end-sc.minTime)/(sc.maxTime-sc.minTime))*width(), (((m_targets[i].offset+m_targets[i].slope*m_targets[i].duration)-sc.minValue)/(sc.maxValue-sc.minValue))*height()));
+			if (x < p1.x() || x > p2.x() || p2.x() == p1.x())
+				continue;
+
+			double yLine = p1.y() + (double)(x-p1.x())/(p2.x()-p1.x())*(p2.y()-p1.y());
+			if (std::abs(y-yLine) <= 5)
+			{
+				m_dragging = true;
+				m_dragState = state;
+				m_dragTarget = i;
+				m_dragStartTarget = m_targets[i];
+				m_dragStartPoint = point(x,y);
+				return;
+			}
+		}
+	}
+
+	if (enabled && !hidden && btn == base_window::LEFT && display_rect().contains(x,y) && m_bounds.size() > 1)
+	{
+		// find syllable bound next to mouse pointer
+		SignalStat sc = getScaler();
+		for (unsigned i=0; i<m_bounds.size(); ++i)
+		{
+			point p = graph_to_gui_space(point(((m_bounds[i]-sc.minTime)/(sc.maxTime-sc.minTime))*width(), 0));
+			if (std::abs(x-p.x()) <= 3)
+			{
+				m_draggingBound = true;
+				m_dragBound = i;
+				return;
+			}
+		}
+	}
+
+	// otherwise move view
+	zoomable_region::on_mouse_down(btn, state, x, y, is_double_click);
+}
+
+void PlotRegion::on_mouse_move (unsigned long state, long x, long y)
+{
+	if (m_draggingBound)
+	{
+		// new bound position between its neighbours
+		SignalStat sc = getScaler();
+		double time = sc.minTime + gui_to_graph_space(point(x,y)).x()/width()*(sc.maxTime-sc.minTime);
+		const double margin (0.01);
+		if (m_dragBound > 0)
+			time = std::max(time, m_bounds[m_dragBound-1]+margin);
+		if (m_dragBound+1 < m_bounds.size())
+			time = std::min(time, m_bounds[m_dragBound+1]-margin);
+		m_bounds[m_dragBound] = time;
+		updateScaler();
+		parent.invalidate_rectangle(rect);
+		return;
+	}
+
+	if (!m_dragging)
+	{
+		zoomable_region::on_mouse_move(state, x, y);
+		return;
+	}
+
+	// value difference of mouse movement
+	SignalStat sc = getScaler();
+	vector<double,2> p0 = gui_to_graph_space(m_dragStartPoint);
+	vector<double,2> p1 = gui_to_graph_space(point(x,y));
+	double deltaValue = (p1.y()-p0.y())/height()*(sc.maxValue-sc.minValue);
+
+	PitchTarget& pt = m_targets[m_dragTarget];
+	pt = m_dragStartTarget;
+	if (m_dragState & base_window::CONTROL)
+	{
+		pt.tau = std::max(1.0, m_dragStartTarget.tau + 0.1*(m_dragStartPoint.y()-y)); // 0.1 ms per pixel
+	}
+	else if (m_dragState & base_window::SHIFT)
+	{
+		pt.slope = m_dragStartTarget.slope + deltaValue/pt.duration;
+	}
+	else
+	{
+		pt.offset = m_dragStartTarget.offset + deltaValue;
+	}
+	parent.invalidate_rectangle(rect);
+
+	if (m_editHandler.is_set())
+	{
+		m_editHandler(m_dragTarget);
+	}
+}
+
+void PlotRegion::on_mouse_up (unsigned long btn, unsigned long state, long x, long y)
+{
+	zoomable_region::on_mouse_up(btn, state, x, y);
+	if (m_draggingBound)
+	{
+		m_draggingBound = false;
+		if (m_boundEditDoneHandler.is_set())
+		{
+			m_boundEditDoneHandler(m_dragBound);
+		}
+	}
+	if (m_dragging)
+	{
+		m_dragging = false;
+		if (m_editDoneHandler.is_set())
+		{
+			m_editDoneHandler(m_dragTarget);
+		}
+	}
+}
+
+void PlotRegion::draw (const canvas& c) const
+{
+	zoomable_region::draw(c);
+
+	rectangle area = c.intersect(display_rect());
+	if (area.is_empty() == true)
+		return;
+
+	if (enabled)
+		fill_rect(c,display_rect(),255);
+	else
+		fill_rect(c,display_rect(),128);
+
+	const SignalStat& scaler = m_scaler;
+
+	// draw bounds
+	for (int i = 0; i < m_bounds.size(); ++i)
+	{
+		double position = ((m_bounds[i]-scaler.minTime)/(scaler.maxTime-scaler.minTime))*width();
+		point p(graph_to_gui_space(vector<double,2>(position,0)));
+		point p2(graph_to_gui_space(vector<double,2>(position,height())));
+		draw_line(c,p2,p ,rgb_pixel(0,0,0), area);
+	}
+
+	// rebuild decimated f0 geometry only if data, size or view has changed
+	if (m_cachedVersion != m_dataVersion || m_cachedRect != display_rect())
+	{
+		decimate(m_origF0, m_origColumns);
+		decimate(m_optF0, m_optColumns);
+		m_cachedVersion = m_dataVersion;
+		m_cachedRect = display_rect();
+	}
+
+	// draw original and optimal f0
+	drawColumns(c, area, m_origColumns, 2, rgb_pixel(0,0,255));
+	drawColumns(c, area, m_optColumns, 1.5, rgb_pixel(100,200,100));
+
+	// draw optimal targets
+	if(!m_targets.empty())
+	{
+		double begin = targetBegin(0);
+		double end = begin;
+		for (int i=0; i<m_targets.size(); ++i)
+		{
+			begin = end;
+			end = begin + m_targets[i].duration;
+			double x1 = ((begin-scaler.minTime)/(scaler.maxTime-scaler.minTime))*width();
+			double y1 = ((m_targets[i].offset-scaler.minValue)/(scaler.maxValue-scaler.minValue))*height();
+			double x2 = ((end-scaler.minTime)/(scaler.maxTime-scaler.minTime))*width();
+			double y2 = (((m_targets[i].offset + m_targets[i].slope*m_targets[i].duration)-scaler.minValue)/(scaler.maxValue-scaler.minValue))*height();
+			draw_line(c,graph_to_gui_space(vector<double,2>(x1,y1)), graph_to_gui_space(vector<double,2>(x2,y2)) ,rgb_pixel(200,100,100), area);
+		}
+	}
+}
+
+SignalStat PlotRegion::analyzeSignal(const TimeSignal &f0) const
+{
+	// single pass, no copies
+	SignalStat result = {f0[0].time, f0[0].time, f0[0].value, f0[0].value};
+	for (unsigned i=1; i<f0.size(); ++i)
+	{
+		result.minTime = std::min(result.minTime, f0[i].time);
+		result.maxTime = std::max(result.maxTime, f0[i].time);
+		result.minValue = std::min(result.minValue, f0[i].value);
+		result.maxValue = std::max(result.maxValue, f0[i].value);
+	}
+
+	return result;
+}
+
+MainWindow::MainWindow() :
+    colorBlack(0,0,0),
+    colorWhite(255,255,255),
+    colorMix(100,200,100),
+    colorRed(255,0,0),
+    colorGray(210,210,210),
+	graph(*this),
+	btnLoadTextGrid(*this),
+	btnLoadPitchTier(*this),
+	btnOptimize(*this),
+	btnStoreGesture(*this),
+	btnCancel(*this),
+    mbar(*this),
+	recTargets(*this),
+	recOptions(*this),
+	recActions(*this),
+	targetGrid(*this),
+	searchGrid(*this),
+	penaltyGrid(*this),
+	searchSpaceGroup(*this),
+	penaltyGroup(*this),
+	tabs(*this),
+	selOnset(*this),
+	lbOnset(*this),
+	lbProgress(*this),
+	m_progressTimer(*this, &MainWindow::onProgressTimer),
+	m_busy(false),
+	m_cancelRequested(false),
+	m_restartsCompleted(0),
+	m_restartsTotal(0),
+	m_bestCost(0.0),
+	m_startTime(0)
+{
+    set_title("Target Optimizer");
+
+    // position the widget that is responsible for drawing the directed graph, the graph_drawer,
+    // just below the mbar (menu bar) widget.
+    graph.set_pos(15,mbar.bottom()+5);
+    graph.set_min_zoom_scale(1.0);
+    set_size(750,520);
+
+    // register the event handlers with their respective widgets
+    btnLoadTextGrid.set_click_handler(*this, &MainWindow::onButtonTextGridOpen);
+    btnLoadPitchTier.set_click_handler(*this, &MainWindow::onButtonPitchTierOpen);
+    btnOptimize.set_click_handler(*this, &MainWindow::onButtonOptimize);
+    btnStoreGesture.set_click_handler(*this, &MainWindow::onButtonSaveAsGesture);
+    btnCancel.set_click_handler(*this, &MainWindow::onButtonCancel);
+    graph.setTargetEditHandler(*this, &MainWindow::onTargetEdited);
+    graph.setTargetEditDoneHandler(*this, &MainWindow::onTargetEditDone);
+    graph.setBoundEditDoneHandler(*this, &MainWindow::onBoundEditDone);
+
+    // now set the text of some of our buttons and labels
+    btnLoadTextGrid.set_name("Load TextGrid");
+    btnLoadPitchTier.set_name("Load PitchTier");
+    btnOptimize.set_name("Optimize");
+    btnStoreGesture.set_name("Save as VTL Gesture");
+    btnCancel.set_name("Cancel");
+    recTargets.set_name("Targets");
+    recOptions.set_name("Options");
+    recActions.set_name("Actions");
+    lbOnset.set_text("Optimize Onset");
+
+    // Now setup the tabbed display.  It will have two tabs, one for the search space
+    // and for regularization
+    tabs.set_number_of_tabs(2);
+    tabs.set_tab_name(0,"Search Space");
+    tabs.set_tab_name(1,"Regularization");
+    searchSpaceGroup.add(searchGrid,0,0);
+    penaltyGroup.add(penaltyGrid,0,0);
+    tabs.set_tab_group(0,searchSpaceGroup);
+    tabs.set_tab_group(1,penaltyGroup);
+
+    // Now setup the menu bar.  We will have two menus.  A File and Help menu.
+    mbar.set_number_of_menus(2);
+    mbar.set_menu_name(0,"File",'F');
+    mbar.set_menu_name(1,"Help",'H');
+
+    // add the entries to the File menu.
+    mbar.menu(0).add_menu_item(menu_item_text("Open TextGrid", *this, &MainWindow::onButtonTextGridOpen, 'T'));
+    mbar.menu(0).add_menu_item(menu_item_text("Open PitchTier", *this, &MainWindow::onButtonPitchTierOpen, 'P'));
+    mbar.menu(0).add_menu_item(menu_item_separator());
+    mbar.menu(0).add_menu_item(menu_item_text("Optimize", *this, &MainWindow::onButtonOptimize, 'O'));
+    mbar.menu(0).add_menu_item(menu_item_text("Re-optimize Changed Bounds", *this, &MainWindow::onMenuReoptimizeBounds, 'R'));
+    mbar.menu(0).add_menu_item(menu_item_separator());
+    mbar.menu(0).add_menu_item(menu_item_text("Save As Gesture",*this, &MainWindow::onButtonSaveAsGesture, 'G'));
+    mbar.menu(0).add_menu_item(menu_item_text("Save As csv",*this, &MainWindow::onMenuSaveAsCsv, 'c'));
+    mbar.menu(0).add_menu_item(menu_item_text("Save As PitchTier",*this, &MainWindow::onMenuSaveAsPitchTier, 'i'));
+    mbar.menu(0).add_menu_item(menu_item_separator());
+    mbar.menu(0).add_menu_item(menu_item_text("Quit",   *this, &MainWindow::onMenuFileQuit,    'Q'));
+
+    // Add the entries to the Help menu.
+    mbar.menu(1).add_menu_item(menu_item_text("Help",   *this, &MainWindow::onMenuFileHelp,'H'));
+    mbar.menu(1).add_menu_item(menu_item_text("About",  *this, &MainWindow::onMenuFileAbout,'A'));
+
+    // refresh elapsed time of a running optimization
+    m_progressTimer.set_delay_time(200);
+
+    // call our helper functions and window resize event to get the widgets
+    // to all arrange themselves correctly in our window.
+    noOptimizationPerformed();
+    on_window_resized();
+}
+
+MainWindow::~MainWindow()
+{
+	// stop a running optimization before the widgets are destroyed
+	{
+		dlib::auto_mutex lock(m_progressMutex);
+		m_cancelRequested = true;
+	}
+	if (m_worker)
+	{
+		m_worker->wait();
+	}
+	m_progressTimer.stop_and_wait();
+
+    close_window();
+}
+
+void MainWindow::noOptimizationPerformed ()
+{
+    btnOptimize.disable();
+    btnStoreGesture.disable();
+    btnCancel.disable();
+    searchGrid.set_grid_size(4,2);
+    penaltyGrid.set_grid_size(5,2);
+    targetGrid.set_grid_size(4,1);
+    targetGrid.disable();
+
+    selOnset.set_checked();
+    searchGrid.set_border_color(colorBlack);
+    searchGrid.set_text(1,0,"slope:  0.0 [st/s] +/- ");
+    searchGrid.set_text(2,0,"offset: mean(f0) [st] +/- ");
+    searchGrid.set_text(3,0,"tau:    15.0 [ms] +/- ");
+    searchGrid.set_background_color(1,0,rgb_pixel(200,250,250));
+    searchGrid.set_background_color(2,0,rgb_pixel(200,250,250));
+    searchGrid.set_background_color(3,0,rgb_pixel(200,250,250));
+    searchGrid.set_editable(1,0,false);
+    searchGrid.set_editable(2,0,false);
+    searchGrid.set_editable(3,0,false);
+    searchGrid.set_column_width(0,150);
+    searchGrid.set_text(1,1,"50.0");
+    searchGrid.set_text(2,1,"20.0");
+    searchGrid.set_text(3,1,"5.0");
+    searchGrid.set_column_width(1,50);
+    searchGrid.set_text(0,0,"parameter");
+    searchGrid.set_text(0,1,"value");
+    searchGrid.set_background_color(0,0,rgb_pixel(170,220,220));
+    searchGrid.set_background_color(0,1,rgb_pixel(170,220,220));
+    searchGrid.set_editable(0,0,false);
+    searchGrid.set_editable(0,1,false);
+
+    penaltyGrid.set_border_color(colorBlack);
+    penaltyGrid.set_text(1,0,"lambda");
+    penaltyGrid.set_text(2,0,"weight-slope");
+    penaltyGrid.set_text(3,0,"weight-offset");
+    penaltyGrid.set_text(4,0,"weight-tau");
+    penaltyGrid.set_background_color(1,0,rgb_pixel(200,250,250));
+    penaltyGrid.set_background_color(2,0,rgb_pixel(200,250,250));
+    penaltyGrid.set_background_color(3,0,rgb_pixel(200,250,250));
+    penaltyGrid.set_background_color(4,0,rgb_pixel(200,250,250));
+    penaltyGrid.set_editable(1,0,false);
+    penaltyGrid.set_editable(2,0,false);
+    penaltyGrid.set_editable(3,0,false);
+    penaltyGrid.set_editable(4,0,false);
+    penaltyGrid.set_column_width(0,150);
+    penaltyGrid.set_text(1,1,"0.0");
+    penaltyGrid.set_text(2,1,"10.0");
+    penaltyGrid.set_text(3,1,"5.0");
+    penaltyGrid.set_text(4,1,"1.0");
+    penaltyGrid.set_column_width(1,50);
+    penaltyGrid.set_text(0,0,"parameter");
+    penaltyGrid.set_text(0,1,"value");
+    penaltyGrid.set_background_color(0,0,rgb_pixel(170,220,220));
+    penaltyGrid.set_background_color(0,1,rgb_pixel(170,220,220));
+    penaltyGrid.set_editable(0,0,false);
+    penaltyGrid.set_editable(0,1,false);
+
+}
+
+void MainWindow::on_window_resized ()
+{
+    // when you override any of the drawable_window events you have to make sure you
+    // call the drawable_window's version of them because it needs to process
+    // the events as well.  So we do that here.
+    drawable_window::on_window_resized();
+
+    // The rest of this function positions the widgets on the window
+    unsigned long width,height;
+    get_size(width,height);
+
+    // Don't do anything if the user just made the window too small.  That is, leave
+    // the widgets where they are.
+    if (width < 500 || height < 350)
+        return;
+
+    // Set the size of the probability tables and the drawing area for the graph
+    graph.set_size(0.97*width,0.55*height-+mbar.height());
+    searchGrid.set_size(0.3*width,0.25*height);
+    penaltyGrid.set_size(0.3*width,0.25*height);
+    targetGrid.set_size(0.35*width,0.25*height);
+    // tell the tabbed display to make itself just the right size to contain
+    // the two probability tables.
+    tabs.fit_to_contents();
+
+
+    // Now position all the widgets in the window.  Note that much of the positioning
+    // is relative to other widgets.  This part of the code I just figured out by
+    // trying stuff and rerunning the program to see if it looked nice.
+
+    btnLoadTextGrid.set_pos(0.35*width+15,graph.bottom()+30);
+	btnLoadPitchTier.set_pos(0.35*width+15,graph.bottom()+60);
+	btnOptimize.set_pos(0.35*width+15,graph.bottom()+90);
+	btnStoreGesture.set_pos(0.35*width+15,graph.bottom()+120);
+	btnCancel.set_pos(0.35*width+15,graph.bottom()+150);
+	lbProgress.set_pos(0.35*width+15,graph.bottom()+185);
+	selOnset.set_pos(15,graph.bottom()+30);
+	targetGrid.set_pos(0.6*width+15,graph.bottom()+30);
+	tabs.set_pos(15,graph.bottom()+50);
+	lbOnset.set_pos(selOnset.right()+10, selOnset.top());
+
+	btnLoadTextGrid.set_size(btnStoreGesture.get_rect().width(), btnStoreGesture.get_rect().height());
+	btnLoadPitchTier.set_size(btnStoreGesture.get_rect().width(), btnStoreGesture.get_rect().height());
+	btnOptimize.set_size(btnStoreGesture.get_rect().width(), btnStoreGesture.get_rect().height());
+	btnCancel.set_size(btnStoreGesture.get_rect().width(), btnStoreGesture.get_rect().height());
+
+
+    // Tell the named rectangle to position itself such that it fits around the
+    // tabbed display that contains the probability tables and the label at the top of the
+    // screen.
+	recOptions.wrap_around(selOnset.get_rect()+tabs.get_rect());
+	recTargets.wrap_around(targetGrid.get_rect());
+	recActions.wrap_around(btnLoadTextGrid.get_rect()+btnCancel.get_rect());
+	//graph.disable();
+}
+
+void MainWindow::openTextGrid (const std::string& fileName)
+{
+    try
+    {
+		// process TextGrid input
+		TextGridReader tgreader (fileName);
+		m_bounds = tgreader.getBounds();
+		graph.setBounds(m_bounds);
+    }
+    catch (...)
+    {
+        message_box("Error", "Unable to load TextGrid file " + fileName);
+    }
+}
+
+void MainWindow::openPitchTier (const std::string& fileName)
+{
+    try
+    {
+		// process PitchTier input
+		PitchTierReader ptreader (fileName);
+		m_origF0 = ptreader.getF0();
+		graph.setOrigF0(m_origF0);
+        set_title("Target Optimizer - " + left_substr(right_substr(fileName,"\\/"), "."));
+    }
+    catch (...)
+    {
+        message_box("Error", "Unable to load TextGrid file " + fileName);
+    }
+}
+
+void MainWindow::onButtonTextGridOpen ()
+{
+    // display a file chooser window and when the user choses a file
+    // call the on_open_file_selected() function
+    open_existing_file_box(*this, &MainWindow::openTextGrid);
+    if (!m_origF0.empty())
+    {
+    	onReadyForOptimize();
+    }
+}
+
+void MainWindow::onButtonPitchTierOpen ()
+{
+    // display a file chooser window and when the user choses a file
+    // call the on_open_file_selected() function
+    open_existing_file_box(*this, &MainWindow::openPitchTier);
+    if (!m_bounds.empty())
+    {
+    	onReadyForOptimize();
+    }
+}
+
+void MainWindow::onReadyForOptimize ()
+{
+	btnOptimize.enable();
+}
+
+void MainWindow::onButtonOptimize ()
+{
+	m_freeTargets.clear();
+	m_changedBounds.clear();
+	startOptimization();
+}
+
+void MainWindow::onTargetEdited (unsigned long index)
+{
+	if (!m_model)
+	{
+		return;
+	}
+
+	// only the edited syllable and the following ones are recalculated
+	m_optTarget[index] = graph.getTargets()[index];
+	m_model->setPitchTarget(index, m_optTarget[index]);
+	m_optF0 = m_model->getF0();
+	graph.setOptimalF0(m_optF0);
+
+	std::ostringstream msg;
+	msg << std::fixed << std::setprecision(2);
+	msg << "Target " << index+1 << ":  slope = " << m_optTarget[index].slope << "   offset = " << m_optTarget[index].offset << "   tau = " << m_optTarget[index].tau;
+	lbProgress.set_text(msg.str());
+}
+
+void MainWindow::onTargetEditDone (unsigned long index)
+{
+	// re-optimize neighbouring targets, edited one is kept fixed
+	m_changedBounds.clear();
+	m_freeTargets.clear();
+	if (index > 0)
+	{
+		m_freeTargets.push_back(index-1);
+	}
+	if (index+1 < m_optTarget.size())
+	{
+		m_freeTargets.push_back(index+1);
+	}
+	if (!m_freeTargets.empty())
+	{
+		startOptimization();
+	}
+}
+
+void MainWindow::onBoundEditDone (unsigned long index)
+{
+	m_bounds = graph.getBounds();
+	onMenuReoptimizeBounds();
+}
+
+void MainWindow::onMenuReoptimizeBounds ()
+{
+	if (m_optTarget.empty())
+	{
+		message_box("Information", "No solution available for re-optimization, please optimize first.");
+		return;
+	}
+
+	// re-optimize targets around bounds changed since last solution (moved in plot or new TextGrid)
+	try
+	{
+		m_freeTargets.clear();
+		m_changedBounds = BobyqaOptimizer::findChangedBounds(m_solutionBounds, m_bounds);
+	}
+	catch (std::exception& e)
+	{
+		message_box("Error", "Number of syllables has changed, please run a full optimization.");
+		return;
+	}
+
+	if (!m_changedBounds.empty())
+	{
+		startOptimization();
+	}
+}
+
+void MainWindow::startOptimization ()
+{
+	// main task runs in background, the window stays responsive
+	{
+		dlib::auto_mutex lock(m_progressMutex);
+		if (m_busy)
+		{
+			return;
+		}
+		m_busy = true;
+		m_cancelRequested = false;
+		m_restartsCompleted = 0;
+		m_restartsTotal = 0;
+		m_bestCost = 0.0;
+		m_startTime = m_clock.get_timestamp();
+	}
+
+	m_parameters = readParameters();
+	blockMainWindow();
+	btnCancel.enable();
+	lbProgress.set_text("Optimizing ...");
+	m_progressTimer.start();
+
+	// previous worker has already finished when not busy
+	m_worker.reset(new thread_function(make_mfp(*this, &MainWindow::runOptimization)));
+}
+
+void MainWindow::onButtonCancel ()
+{
+	{
+		dlib::auto_mutex lock(m_progressMutex);
+		m_cancelRequested = true;
+	}
+	btnCancel.disable();
+}
+
+void MainWindow::runOptimization ()
+{
+	std::ostringstream msg;
+	const bool local = !m_freeTargets.empty() || !m_changedBounds.empty();
+	try
+	{
+		OptimizationProblem problem (m_parameters, m_origF0, m_bounds);
+		BobyqaOptimizer optimizer;
+		optimizer.setObserver(this);
+		OptimizationReport report;
+		if (!m_changedBounds.empty())
+		{
+			report = optimizer.reoptimize(problem, m_optOnset.value, m_optTarget, m_changedBounds);
+		}
+		else if (local)
+		{
+			problem.setOptimum(m_optOnset.value, m_optTarget);
+			report = optimizer.optimizeLocal(problem, m_freeTargets);
+		}
+		else
+		{
+			report = optimizer.optimize(problem);
+		}
+
+		m_optTarget = problem.getPitchTargets();
+		m_optOnset = problem.getOnset();
+		m_solutionBounds = m_bounds;
+		m_model.reset(new IncrementalModelF0(m_bounds, 1.0/200.0));
+		m_model->setModel(m_optOnset.value, m_optTarget);
+		m_optF0 = m_model->getF0();
+		graph.setTargets(m_optTarget);
+		graph.setOptimalF0(m_optF0);
+
+		FitMetrics metrics = problem.getFitMetrics();
+		const char* sep = local ? "   " : "\n";
+		msg << (report.truncated ? "Optimization cancelled, best solution so far:" : (local ? "Local re-optimization successful." : "Optimization successful!"));
+		msg << sep << "RMSE = " << metrics.rmse << sep << "CORR = " << metrics.correlation << sep << "MAX = " << metrics.maxError;
+	}
+	catch (std::exception& e)
+	{
+		msg << "Optimization failed!\n" << e.what();
+	}
+
+	m_progressTimer.stop();
+	onProgressTimer();
+	btnCancel.disable();
+	unblockMainWindow();
+	if (m_optTarget.empty())
+	{
+		btnStoreGesture.disable();
+	}
+	if (local)
+	{
+		// no interruption of interactive editing
+		lbProgress.set_text(msg.str());
+	}
+	else
+	{
+		message_box("Information", msg.str());
+	}
+
+	dlib::auto_mutex lock(m_progressMutex);
+	m_busy = false;
+}
+
+void MainWindow::onIncumbent(const double cost, const double onsetValue, const TargetVector &targets, const double elapsed)
+{
+	{
+		dlib::auto_mutex lock(m_progressMutex);
+		m_bestCost = cost;
+	}
+
+	// show current best model f0 and targets
+	TamModelF0 tamF0 (m_bounds);
+	tamF0.setOnsetValue(onsetValue);
+	tamF0.setPitchTargets(targets);
+	graph.setTargets(targets);
+	graph.setOptimalF0(tamF0.calculateF0(1.0/200.0));
+}
+
+void MainWindow::onRestart(const unsigned completed, const unsigned total, const double bestCost, const double elapsed)
+{
+	{
+		dlib::auto_mutex lock(m_progressMutex);
+		m_restartsCompleted = completed;
+		m_restartsTotal = total;
+	}
+	onProgressTimer();
+}
+
+bool MainWindow::stopRequested()
+{
+	dlib::auto_mutex lock(m_progressMutex);
+	return m_cancelRequested;
+}
+
+void MainWindow::onProgressTimer ()
+{
+	std::ostringstream msg;
+	{
+		dlib::auto_mutex lock(m_progressMutex);
+		msg << std::fixed << std::setprecision(1);
+		msg << "Restarts: " << m_restartsCompleted << "/" << m_restartsTotal;
+		msg << "   Cost: " << m_bestCost;
+		msg << "   Time: " << (m_clock.get_timestamp() - m_startTime)/1e6 << " s";
+	}
+	lbProgress.set_text(msg.str());
+}
+
+ParameterSet MainWindow::readParameters()
+{
+	//calculate mean f0
+	double meanF0 = 0.0;
+	for (int i=0; i<m_origF0.size(); ++i)
+	{
+		meanF0 += m_origF0[i].value;
+	}
+	meanF0 /= m_origF0.size();
+
+	ParameterSet parameters;
+	try
+	{
+		parameters.deltaSlope = atof(searchGrid.text(1,1).c_str());
+		parameters.deltaOffset = atof(searchGrid.text(2,1).c_str());
+		parameters.deltaTau = atof(searchGrid.text(3,1).c_str());
+		parameters.weightSlope = atof(penaltyGrid.text(2,1).c_str());
+		parameters.weightOffset = atof(penaltyGrid.text(3,1).c_str());
+		parameters.weightTau = atof(penaltyGrid.text(4,1).c_str());
+		parameters.lambda = atof(penaltyGrid.text(1,1).c_str());
+		parameters.meanSlope = 0.0;
+		parameters.meanOffset = meanF0;
+		parameters.meanTau = 15.0;
+	}
+	catch(...)
+	{
+		throw dlib::error("Wrong Option Format. Please Enter a number!");
+	}
+
+	return parameters;
+}
+
+// This event is called when the user choses which file to save the graph to
+void MainWindow::onSaveFileGesture (const std::string& fileName)
+{
+    GestureWriter gwriter (fileName + ".ges");
+    gwriter.writeTargets(m_optOnset, m_optTarget);
+}
+
+// This event is called when the user selects from the menu bar File->Save As
+void MainWindow::onButtonSaveAsGesture ()
+{
+    save_file_box(*this, &MainWindow::onSaveFileGesture);
+}
+
+// This event is called when the user choses which file to save the graph to
+void MainWindow::onSaveFileCsv (const std::string& fileName)
+{
+	CsvWriter cwriter (fileName + ".csv");
+	cwriter.writeTargets(m_optOnset, m_optTarget);
+}
+
+// This event is called when the user selects from the menu bar File->Save As
+void MainWindow::onMenuSaveAsCsv ()
+{
+    save_file_box(*this, &MainWindow::onSaveFileCsv);
+}
+
+// This event is called when the user choses which file to save the graph to
+void MainWindow::onSaveFilePitchTier(const std::string& fileName)
+{
+	PitchTierWriter pwriter (fileName + "-tam.PitchTier");
+	pwriter.writeF0(m_optF0);
+}
+
+// This event is called when the user selects from the menu bar File->Save As
+void MainWindow::onMenuSaveAsPitchTier ()
+{
+    save_file_box(*this, &MainWindow::onSaveFilePitchTier);
+}
+
+void MainWindow::blockMainWindow()
+{
+	tabs.disable();
+	targetGrid.disable();
+	btnLoadTextGrid.disable();
+	btnLoadPitchTier.disable();
+	btnOptimize.disable();
+	btnStoreGesture.disable();
+	graph.disable();
+	mbar.disable();
+}
+
+void MainWindow::unblockMainWindow()
+{
+	tabs.enable();
+	targetGrid.enable();
+	btnLoadTextGrid.enable();
+	btnLoadPitchTier.enable();
+	btnOptimize.enable();
+	btnStoreGesture.enable();
+	graph.enable();
+	mbar.enable();
+}
+
+void MainWindow::onMenuFileQuit()
+{
+	close_window();
+}
+
+void MainWindow::onMenuFileHelp()
+{
+	message_box("Help",
+	                "To create new nodes right click on the drawing area.\n"
+	                "To create edges select the parent node and then shift+left click on the child node.\n"
+	                "To remove nodes or edges select them by left clicking and then press the delete key.");
+}
+
+void MainWindow::onMenuFileAbout()
+{
+    message_box("About","This application is the GUI front end to the dlib C++ Library's\n"
+                "Bayesian Network inference utilities\n\n"
+                "Version 1.2\n\n"
+                "See http://dlib.net for updates");
+}
@@ -0,0 +1,200 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "journal.h"
+
+// bump when the record format changes
+static const char* JOURNAL_FORMAT = "TargetOptimizer journal 1";
+
+BatchJournal::BatchJournal (const std::string &journalFile, const double syncInterval)
+	: m_file(journalFile), m_fd(-1), m_syncInterval(syncInterval), m_dirty(false), m_syncTimer(*this, &BatchJournal::onSyncTimer)
+{
+	load();
+
+	m_fd = open(m_file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (m_fd < 0)
+	{
+		throw dlib::error("[BatchJournal] Journal file cannot be opened!");
+	}
+
+	// a new journal starts durable, so a resumed run can always recognize it
+	if (lseek(m_fd, 0, SEEK_END) == 0)
+	{
+		append(std::string(JOURNAL_FORMAT) + "\n");
+		sync();
+	}
+
+	// records are synced by time, not by the next record, so a finished job is durable within the interval
+	if (m_syncInterval > 0.0)
+	{
+		m_syncTimer.set_delay_time(std::max(1UL, (unsigned long)(m_syncInterval*1000)));
+		m_syncTimer.start();
+	}
+}
+
+BatchJournal::~BatchJournal ()
+{
+	m_syncTimer.stop_and_wait();
+	if (m_fd >= 0)
+	{
+		fsync(m_fd);
+		close(m_fd);
+	}
+}
+
+bool BatchJournal::finished(const std::string &job, std::string &result) const
+{
+	dlib::auto_mutex lock(m_mutex);
+	std::map<std::string,std::string>::const_iterator it = m_finished.find(job);
+	if (it == m_finished.end())
+	{
+		return false;
+	}
+	result = it->second;
+	return true;
+}
+
+unsigned BatchJournal::attempts(const std::string &job) const
+{
+	dlib::auto_mutex lock(m_mutex);
+	std::map<std::string,unsigned>::const_iterator it = m_attempts.find(job);
+	return (it == m_attempts.end() || m_finished.count(job) > 0) ? 0 : it->second;
+}
+
+void BatchJournal::markStarted(const std::string &job)
+{
+	dlib::auto_mutex lock(m_mutex);
+	append("start\t" + job + "\n");
+	m_attempts[job]++;
+}
+
+void BatchJournal::markFinished(const std::string &job, const std::string &result)
+{
+	if (result.find('\n') != std::string::npos)
+	{
+		throw dlib::error("[markFinished] Journal record must be a single line!");
+	}
+
+	dlib::auto_mutex lock(m_mutex);
+	append("done\t" + job + "\t" + result + "\n");
+	m_finished[job] = result;
+}
+
+void BatchJournal::sync()
+{
+	dlib::auto_mutex lock(m_mutex);
+	if (m_dirty && fsync(m_fd) != 0)
+	{
+		throw dlib::error("[sync] Journal cannot be synced!");
+	}
+	m_dirty = false;
+}
+
+std::string BatchJournal::makeKey(const std::string &textGridFile, const std::string &pitchTierFile)
+{
+	// job list entries are tab separated, so neither name contains a tab
+	return textGridFile + "\t" + pitchTierFile;
+}
+
+void BatchJournal::load()
+{
+	std::ifstream fin (m_file.c_str(), std::ios::binary);
+	if (!fin.good())
+	{
+		return;
+	}
+	std::ostringstream content;
+	content << fin.rdbuf();
+	const std::string data = content.str();
+	fin.close();
+	if (data.empty())
+	{
+		return;
+	}
+
+	// only records ending with a line break were written completely
+	const std::string::size_type complete = (data.find('\n') == std::string::npos) ? 0 : data.rfind('\n') + 1;
+	if (complete == 0)
+	{
+		// torn header of a fresh journal
+		if (truncate(m_file.c_str(), 0) != 0)
+		{
+			throw dlib::error("[BatchJournal] Torn journal record cannot be removed!");
+		}
+		return;
+	}
+	std::istringstream lines (data.substr(0, complete));
+	std::string line;
+	if (!std::getline(lines, line) || line != JOURNAL_FORMAT)
+	{
+		throw dlib::error("[BatchJournal] File is not a journal of this version: " + m_file);
+	}
+	while (std::getline(lines, line))
+	{
+		// records: start <textgrid> <pitchtier> | done <textgrid> <pitchtier> <result>
+		const std::string::size_type a = line.find('\t');
+		const std::string::size_type b = (a == std::string::npos) ? a : line.find('\t', a+1);
+		if (b == std::string::npos)
+			continue;
+		const std::string::size_type c = line.find('\t', b+1);
+		const std::string type = line.substr(0, a);
+		const std::string job = line.substr(a+1, (c == std::string::npos) ? std::string::npos : c-a-1);
+		if (type == "start")
+		{
+			m_attempts[job]++;
+		}
+		else if (type == "done" && c != std::string::npos)
+		{
+			m_finished[job] = line.substr(c+1);
+		}
+	}
+
+	// drop a torn last record, so the next record starts on a fresh line
+	if (complete < data.size() && truncate(m_file.c_str(), complete) != 0)
+	{
+		throw dlib::error("[BatchJournal] Torn journal record cannot be removed!");
+	}
+}
+
+void BatchJournal::append(const std::string &record)
+{
+	// one write per record, appends of a single write are not interleaved with other writers
+	const char *data = record.data();
+	std::string::size_type left = record.size();
+	while (left > 0)
+	{
+		const ssize_t written = write(m_fd, data, left);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+		{
+			throw dlib::error("[append] Journal cannot be written!");
+		}
+		data += written;
+		left -= written;
+	}
+	m_dirty = true;
+
+	// without interval every record is synced right away
+	if (m_syncInterval <= 0.0)
+	{
+		if (fsync(m_fd) != 0)
+		{
+			throw dlib::error("[append] Journal cannot be synced!");
+		}
+		m_dirty = false;
+	}
+}
+
+void BatchJournal::onSyncTimer()
+{
+	// a failed sync leaves the records dirty, the final sync reports the error
+	dlib::auto_mutex lock(m_mutex);
+	if (m_dirty && fsync(m_fd) == 0)
+	{
+		m_dirty = false;
+	}
+}
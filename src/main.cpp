@@ -1,146 +1,659 @@
 #include <iostream>
 #include <string>
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#include <cmath>
+#include <dlib/string.h>
+#include <dlib/misc_api.h>
 #include <dlib/cmd_line_parser.h>
+#include <dlib/dir_nav.h>
+#include <dlib/smart_pointers.h>
 #include "model.h"
 #include "dataio.h"
+#include "profiler.h"
+#include "warmstart.h"
+#include "resultcache.h"
+#include "sweep.h"
+#include "scheduler.h"
+#include "journal.h"
+#include "arena.h"
 
-int main(int argc, char* argv[])
+// reads inputs, optimizes and writes the requested outputs of a single job, signals and tables on the job's arena
+static void runJob(const dlib::command_line_parser &parser, const std::string &textGridFile, const std::string &pitchTierFile, Arena &arena, Profiler *profiler, WarmStartStore *store, ResultCache *cache, RestartPool *pool, std::ostream &log, JobResult &result)
 {
-	try
+	BoundVector bounds ((ArenaAllocator<double>(&arena)));
+	TimeSignal f0 ((ArenaAllocator<Sample>(&arena)));
+	std::string fileName;
+	{
+		Profiler::Scope scope (profiler, "parse");
+
+		// process TextGrid input
+		TextGridReader tgreader (textGridFile, &arena);
+		bounds = tgreader.getBounds();
+
+		// process PitchTier input
+		PitchTierReader ptreader (pitchTierFile, &arena);
+		f0 = ptreader.getF0();
+		fileName = ptreader.getFileName();
+	}
+
+	Profiler::Scope setupScope (profiler, "setup");
+
+	//calculate mean f0
+	double meanF0 = 0.0;
+	for (int i=0; i<f0.size(); ++i)
 	{
-		if(argc < 2)
+		meanF0 += f0[i].value;
+	}
+	meanF0 /= f0.size();
+
+	// process optional parameter options
+	ParameterSet parameters;
+	parameters.deltaSlope = get_option(parser,"m-range",50.0);
+	parameters.deltaOffset = get_option(parser,"b-range",20.0);
+	parameters.deltaTau = get_option(parser,"t-range",5.0);
+	parameters.weightSlope = get_option(parser,"m-weight",10.0);
+	parameters.weightOffset = get_option(parser,"b-weight",5.0);
+	parameters.weightTau = get_option(parser,"t-weight",1.0);
+	parameters.lambda = get_option(parser,"lambda",0.0);
+	parameters.meanSlope = 0.0;
+	parameters.meanOffset = meanF0;
+	parameters.meanTau = 15.0;
+
+	// main functionality
+	OptimizationProblem problem (parameters, f0, bounds, &arena);
+	setupScope.close();
+	result.parameters = parameters;
+
+	// global optimization results are cached, keyed by everything affecting them;
+	// warm starts depend on the store's contents at the time, their results are not cached
+	std::string cacheKey;
+	CachedResult cached;
+	if (cache != 0 && store == 0 && !parser.option("online") && !parser.option("reoptimize") && !parser.option("sweep"))
+	{
+		std::ostringstream settings;
+		settings << "restarts=" << get_option(parser,"restarts",0) << " precision=" << result.precision;
+		cacheKey = ResultCache::makeKey(bounds, f0, parameters, settings.str());
+		result.cached = cache->lookup(cacheKey, cached);
+	}
+
+	Profiler::Scope optimizeScope (profiler, "optimize");
+	if (parser.option("online"))
+	{
+		// feed input in time order like a live source would
+		result.mode = "online";
+		OnlineTargetEstimator estimator (parameters, get_option(parser,"online",0.1));
+		unsigned b (0);
+		for (unsigned k=0; k<f0.size(); ++k)
 		{
-			// ********** open GUI **********
-		    // create our window
-		    MainWindow myWindow;
+			while (b < bounds.size() && bounds[b] < f0[k].time)
+			{
+				estimator.addBound(bounds[b++]);
+			}
+			estimator.addSample(f0[k]);
+		}
+		while (b < bounds.size())
+		{
+			estimator.addBound(bounds[b++]);
+		}
+		estimator.finish();
 
-		    // tell our window to put itself on the screen
-		    myWindow.show();
+		TargetVector targets;
+		while (estimator.hasTarget())
+		{
+			targets.push_back(estimator.nextTarget());
+		}
+		problem.setOptimum(estimator.getOnset().value, targets);
+	}
+	else if (parser.option("reoptimize"))
+	{
+		// warm start from previous solution, only targets next to changed bounds are free
+		result.mode = "reoptimize";
+		CsvReader creader (parser.option("reoptimize").argument());
+		std::vector<unsigned> changed = BobyqaOptimizer::findChangedBounds(creader.getBounds(), bounds, 1e-4);
+		BobyqaOptimizer optimizer;
+		optimizer.setTimeBudget(get_option(parser,"time-budget",0.0));
+		optimizer.setProfiler(profiler);
+		result.report = optimizer.reoptimize(problem, creader.getOnset().value, creader.getTargets(), changed, get_option(parser,"neighbourhood",1), parser.option("polish"));
+		log << "Re-optimized targets next to " << changed.size() << " changed bounds." << std::endl;
+	}
+	else if (parser.option("sweep"))
+	{
+		// walk the grid on the parsed inputs, keep the point with the lowest held-out error
+		result.mode = "sweep";
+		std::vector<double> values;
+		std::vector<std::string> tokens = dlib::split(parser.option("sweep").argument(), ",");
+		for (unsigned i=0; i<tokens.size(); ++i)
+		{
+			values.push_back(dlib::string_cast<double>(dlib::trim(tokens[i])));
+		}
+		result.sweepParameter = get_option(parser,"sweep-param",std::string("lambda"));
+		std::vector<ParameterSet> grid = ParameterSweep::makeGrid(parameters, result.sweepParameter, values);
+		if (grid.empty())
+		{
+			throw dlib::error("[runJob] Empty sweep grid!");
+		}
+
+		ParameterSweep sweep (f0, bounds);
+		sweep.setThreads((pool != 0) ? 1 : get_option(parser,"threads",1)); // jobs run side by side in a batch
+		sweep.setFolds(get_option(parser,"folds",5));
+		sweep.setRestarts(get_option(parser,"restarts",0));
+		result.sweep = sweep.run(grid);
 
-		    // wait until the user closes this window before we let the program
-		    // terminate.
-		    myWindow.wait_until_closed();
+		const SweepPoint &best = result.sweep[ParameterSweep::selectBest(result.sweep)];
+		if (!std::isfinite(best.heldOutRmse))
+		{
+			log << "No samples could be held out for cross-validation, keeping the first grid point." << std::endl;
+		}
+		for (unsigned i=0; i<result.sweep.size(); ++i)
+		{
+			const SweepPoint &point = result.sweep[i];
+			log << (&point == &best ? "* " : "  ") << result.sweepParameter << "=" << values[i] << "\tRMSE=" << point.metrics.rmse << "\tCV=" << point.heldOutRmse << std::endl;
+			result.report.restarts += point.report.restarts;
+			result.report.evaluations += point.report.evaluations;
+		}
 
-			// avoid console pop up on windows
-			#ifdef _MSC_VER
-			#   pragma comment( linker, "/entry:mainCRTStartup" )
-			#   pragma comment( linker, "/SUBSYSTEM:WINDOWS" )
-			#endif
+		problem = OptimizationProblem(best.parameters, f0, bounds, &arena);
+		problem.setOptimum(best.solution.onset, best.solution.targets);
+		result.parameters = best.parameters;
+		result.report.cost = best.report.cost;
+	}
+	else if (result.cached)
+	{
+		problem.setOptimum(cached.solution.onset, cached.solution.targets);
+		result.report.cost = cached.cost;
+		log << "Using cached result." << std::endl;
+	}
+	else
+	{
+		BobyqaOptimizer optimizer;
+		ConsoleProgressWriter progress;
+		optimizer.setTimeBudget(get_option(parser,"time-budget",0.0));
+		optimizer.setThreads(get_option(parser,"threads",1));
+		optimizer.setProfiler(profiler);
+		optimizer.setPool(pool);
+		optimizer.setRestarts(get_option(parser,"restarts",0));
+		if (result.precision == "single")
+		{
+			optimizer.setPrecision(SINGLE_PRECISION);
+		}
+		else if (result.precision == "mixed")
+		{
+			optimizer.setPrecision(MIXED_PRECISION);
+		}
+		if (parser.option("progressive"))
+		{
+			optimizer.setObserver(&progress);
+		}
+
+		// seed first restarts with the nearest stored solutions
+		const std::string speaker = get_option(parser,"speaker",std::string(""));
+		const std::string context = get_option(parser,"context",std::string(""));
+		if (store != 0)
+		{
+			std::vector<ModelSolution> seeds = store->findNearest(speaker, context, meanF0, bounds, get_option(parser,"warm-count",3));
+			optimizer.setInitialSolutions(seeds);
+			result.warmStarts = seeds.size();
+		}
+
+		result.report = optimizer.optimize(problem);
+		if (result.report.truncated)
+		{
+			log << "Time budget exceeded after " << result.report.restarts << " restarts, returning best solution so far." << std::endl;
+		}
+		else if (store != 0)
+		{
+			ModelSolution solution = {problem.getOnset().value, problem.getPitchTargets()};
+			store->addSolution(speaker, context, meanF0, solution);
+			store->save();
+		}
+
+		if (!cacheKey.empty() && !result.report.truncated)
+		{
+			cached.cost = result.report.cost;
+			cached.solution.onset = problem.getOnset().value;
+			cached.solution.targets = problem.getPitchTargets();
+			cache->store(cacheKey, cached);
+		}
+	}
+	optimizeScope.close();
+
+	// laplace approximation at the optimum
+	if (parser.option("uncertainty"))
+	{
+		Profiler::Scope scope (profiler, "uncertainty");
+		result.uncertainty = problem.estimateUncertainty();
+	}
+
+	Profiler::Scope writeScope (profiler, "write");
+	TargetVector optTargets = problem.getPitchTargets();
+	TimeSignal optF0 = problem.getModelF0(get_option(parser,"rate",200.0));
+	Sample optOnset = problem.getOnset();
+
+	// process gesture-file output option
+	if (parser.option("g"))
+	{
+		GestureWriter gwriter (fileName + ".ges");
+		gwriter.writeTargets(optOnset, optTargets);
+	}
+
+	// process csv-file output option
+	if (parser.option("c"))
+	{
+		CsvWriter cwriter (fileName + ".csv");
+		if (parser.option("uncertainty"))
+		{
+			cwriter.writeTargets(optOnset, optTargets, result.uncertainty);
 		}
 		else
 		{
-			// ********** command line parsing **********
-			dlib::command_line_parser parser;
-
-			// command line options
-			parser.add_option("h","Display this help message.");
-			parser.set_group_name("Output Options");
-			parser.add_option("g","Choose for VTL gesture file.");
-			parser.add_option("c","Choose for csv table file.");
-			parser.add_option("p","Choose for PitchTier file.");
-			parser.set_group_name("Additional Parameter Options");
-			parser.add_option("lambda","Specify regularization parameter.",1);
-			parser.add_option("m-range","Specify search space for slope parameter.",1);
-			parser.add_option("b-range","Specify search space for offset parameter.",1);
-			parser.add_option("t-range","Specify search space for time constant parameter.",1);
-			parser.add_option("m-weight","Specify regularization weight for slope parameter.",1);
-			parser.add_option("b-weight","Specify regularization weight for offset parameter.",1);
-			parser.add_option("t-weight","Specify regularization weight for time constant parameter.",1);
-
-			// parse command line
-			parser.parse(argc,argv);
-
-			// check command line options
-			const char* one_time_opts[] = {"h", "g", "c", "p", "m-range", "b-range", "t-range", "m-weight", "b-weight", "t-weight"};
-			parser.check_one_time_options(one_time_opts);
-			parser.check_option_arg_range("m-range", 0.0, 100.0);
-			parser.check_option_arg_range("b-range", 0.0, 100.0);
-			parser.check_option_arg_range("t-range", 0.0, 14.999);
-			parser.check_option_arg_range("m-weight", 0.0, 1e9);
-			parser.check_option_arg_range("b-weight", 0.0, 1e9);
-			parser.check_option_arg_range("t-weight", 0.0, 1e9);
-			parser.check_option_arg_range("lambda", 0.0, 1e15);
-
-			// process help option
-			if (parser.option("h"))
+			cwriter.writeTargets(optOnset, optTargets);
+		}
+	}
+
+	// process PitchTarget-file output option
+	if (parser.option("p"))
+	{
+		PitchTierWriter pwriter (fileName + "-tam.PitchTier");
+		pwriter.writeF0(optF0);
+	}
+	writeScope.close();
+
+
+	// print results
+	result.onset = optOnset;
+	result.targets = optTargets;
+	result.metrics = problem.getFitMetrics();
+	result.success = true;
+	log << "Optimization successful.\tRMSE=" << result.metrics.rmse << "\tCORR=" << result.metrics.correlation << std::endl;
+}
+
+// pairs of TextGrid and PitchTier files, one job per line
+static std::vector<std::pair<std::string,std::string> > readJobList(const std::string &listFile)
+{
+	std::ifstream fin (listFile.c_str());
+	if (!fin.good())
+	{
+		throw dlib::error("[readJobList] Job list file not found!");
+	}
+
+	std::vector<std::pair<std::string,std::string> > jobs;
+	std::string line;
+	while (std::getline(fin, line))
+	{
+		line = dlib::trim(line, " \r\n");
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::vector<std::string> tokens = dlib::split(line, "\t");
+		if (tokens.size() != 2)
+		{
+			throw dlib::error("[readJobList] Wrong job list format: " + line);
+		}
+		jobs.push_back(std::make_pair(tokens[0], tokens[1]));
+	}
+
+	return jobs;
+}
+
+// relative cost of each job for scheduling, without parsing the inputs; missing files fail fast and cost nothing
+static std::vector<double> estimateJobCosts(const std::vector<std::pair<std::string,std::string> > &jobs)
+{
+	std::vector<double> costs;
+	for (unsigned j=0; j<jobs.size(); ++j)
+	{
+		double cost (0.0);
+		try
+		{
+			cost = BatchScheduler::estimateCost(dlib::file(jobs[j].first).size(), dlib::file(jobs[j].second).size());
+		}
+		catch (std::exception&)
+		{
+		}
+		costs.push_back(cost);
+	}
+	return costs;
+}
+
+// runs single jobs and collects their outputs, jobs may run side by side
+class JobRunner : public BatchJobs {
+public:
+	JobRunner (const dlib::command_line_parser &parser, const std::vector<std::pair<std::string,std::string> > &jobs, Profiler *profiler, WarmStartStore *store, ResultCache *cache, JsonLinesWriter *json, RestartPool *pool, BatchJournal *journal, const bool rethrow)
+		: m_parser(parser), m_jobs(jobs), m_profiler(profiler), m_store(store), m_cache(cache), m_json(json), m_pool(pool), m_journal(journal), m_rethrow(rethrow), m_failed(0) {}
+
+	void runJob (const unsigned j)
+	{
+		const dlib::command_line_parser &parser = m_parser;
+		JobResult result;
+		result.textGridFile = m_jobs[j].first;
+		result.pitchTierFile = m_jobs[j].second;
+		result.success = false;
+		result.mode = "global";
+		result.threads = get_option(parser,"threads",1);
+		result.timeBudget = get_option(parser,"time-budget",0.0);
+		result.warmStarts = 0;
+		result.precision = get_option(parser,"precision",std::string("double"));
+		OptimizationReport empty = {0.0, 0, false, 0, 0.0};
+		result.report = empty;
+		result.cached = false;
+
+		// console output of a job is written at once, so jobs running side by side do not interleave
+		std::ostringstream log;
+		dlib::timestamper ts;
+		const dlib::uint64 start = ts.get_timestamp();
+		const std::clock_t cpuStart = std::clock();
+		const double threadCpuStart = Profiler::cpuTime();
+		const std::string key = BatchJournal::makeKey(m_jobs[j].first, m_jobs[j].second);
+
+		// the job's allocations on the worker's arena are released when the job ends
+		Arena &arena = Arena::local();
+		Arena::Scope jobScope (arena);
+
+		// records of jobs running side by side are told apart by the job
+		dlib::scoped_ptr<Profiler> profiler;
+		if (m_profiler != 0)
+		{
+			profiler.reset(new Profiler(*m_profiler, m_jobs[j].second));
+		}
+		try
+		{
+			// a job that took the process down repeatedly is not tried again
+			if (m_journal != 0)
 			{
-				std::cout << "Usage: TargetOptimizer <TextGrid-file> <PitchTier-file> { <options> | <arg> }\n";
-				parser.print_options();
-				return EXIT_SUCCESS;
+				const unsigned attempts = m_journal->attempts(key);
+				if (attempts >= get_option(parser,"max-attempts",3u))
+				{
+					std::ostringstream msg;
+					msg << "[runJob] Job did not finish in " << attempts << " attempts!";
+					throw dlib::error(msg.str());
+				}
+				m_journal->markStarted(key);
 			}
 
-			// check number of default arguments
-			if (parser.number_of_arguments() != 2)
+			::runJob(parser, m_jobs[j].first, m_jobs[j].second, arena, profiler.get(), m_store, m_cache, m_pool, (m_pool != 0) ? log : std::cout, result);
+		}
+		catch (std::exception& e)
+		{
+			if (m_rethrow)
 			{
-				std::cout << "Error in command line:\n   You must specify two input files.\n";
-				std::cout << "\nTry the -h option for more information." << std::endl;
-				return EXIT_FAILURE;
+				throw;
 			}
+			result.error = e.what();
+		}
+		result.wall = (ts.get_timestamp() - start)/1e6;
+		if (m_pool != 0)
+		{
+			result.cpu = Profiler::cpuTime() - threadCpuStart + result.report.helperCpu;
+		}
+		else
+		{
+			result.cpu = (double)(std::clock() - cpuStart)/CLOCKS_PER_SEC;
+		}
 
-			// process TextGrid input
-			TextGridReader tgreader (parser[0]);
-			BoundVector bounds = tgreader.getBounds();
-
-			// process PitchTier input
-			PitchTierReader ptreader (parser[1]);
-			TimeSignal f0 = ptreader.getF0();
-			std::string fileName = ptreader.getFileName();
-
-			//calculate mean f0
-			double meanF0 = 0.0;
-			for (int i=0; i<f0.size(); ++i)
+		dlib::auto_mutex lock(m_mutex);
+		std::cout << log.str() << std::flush;
+		if (!result.success)
+		{
+			m_failed++;
+			std::cerr << "[main] Job failed: " << m_jobs[j].second << "\n" << result.error << std::endl;
+		}
+		const std::string line = JsonLinesWriter::format(result);
+		if (m_journal != 0 && result.success)
+		{
+			// the result stays valid, the job just runs again on resume
+			try
 			{
-				meanF0 += f0[i].value;
+				m_journal->markFinished(key, line);
 			}
-			meanF0 /= f0.size();
-
-			// process optional parameter options
-			ParameterSet parameters;
-			parameters.deltaSlope = get_option(parser,"m-range",50.0);
-			parameters.deltaOffset = get_option(parser,"b-range",20.0);
-			parameters.deltaTau = get_option(parser,"t-range",5.0);
-			parameters.weightSlope = get_option(parser,"m-weight",10.0);
-			parameters.weightOffset = get_option(parser,"b-weight",5.0);
-			parameters.weightTau = get_option(parser,"t-weight",1.0);
-			parameters.lambda = get_option(parser,"lambda",0.0);
-			parameters.meanSlope = 0.0;
-			parameters.meanOffset = meanF0;
-			parameters.meanTau = 15.0;
-
-			// main functionality
-			OptimizationProblem problem (parameters, f0, bounds);
-			BobyqaOptimizer optimizer;
-			optimizer.optimize(problem);
-			TargetVector optTargets = problem.getPitchTargets();
-			TimeSignal optF0 = problem.getModelF0();
-			Sample optOnset = problem.getOnset();
-
-			// process gesture-file output option
-			if (parser.option("g"))
+			catch (std::exception& e)
 			{
-				GestureWriter gwriter (fileName + ".ges");
-				gwriter.writeTargets(optOnset, optTargets);
+				std::cerr << "[main] Job cannot be journaled: " << m_jobs[j].second << "\n" << e.what() << std::endl;
 			}
+		}
+		if (m_json != 0)
+		{
+			m_json->writeLine(line);
+		}
+	}
+
+	unsigned failed () const { return m_failed; }
+
+private:
+	const dlib::command_line_parser &m_parser;
+	const std::vector<std::pair<std::string,std::string> > &m_jobs;
+	Profiler *m_profiler;
+	WarmStartStore *m_store;
+	ResultCache *m_cache;
+	JsonLinesWriter *m_json;
+	RestartPool *m_pool; // only in batch mode
+	BatchJournal *m_journal; // null without journal
+	bool m_rethrow;
+	unsigned m_failed;
+	dlib::mutex m_mutex;
+};
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// ********** command line parsing **********
+		dlib::command_line_parser parser;
+
+		// command line options
+		parser.add_option("h","Display this help message.");
+		parser.set_group_name("Output Options");
+		parser.add_option("g","Choose for VTL gesture file.");
+		parser.add_option("c","Choose for csv table file.");
+		parser.add_option("p","Choose for PitchTier file.");
+		parser.add_option("rate","Specify sampling rate of PitchTier output in Hz.",1);
+		parser.add_option("uncertainty","Add standard errors and correlations of the targets (laplace approximation) to csv and json output.");
+		parser.set_group_name("Additional Parameter Options");
+		parser.add_option("lambda","Specify regularization parameter.",1);
+		parser.add_option("m-range","Specify search space for slope parameter.",1);
+		parser.add_option("b-range","Specify search space for offset parameter.",1);
+		parser.add_option("t-range","Specify search space for time constant parameter.",1);
+		parser.add_option("m-weight","Specify regularization weight for slope parameter.",1);
+		parser.add_option("b-weight","Specify regularization weight for offset parameter.",1);
+		parser.add_option("t-weight","Specify regularization weight for time constant parameter.",1);
+		parser.set_group_name("Processing Options");
+		parser.add_option("online","Estimate targets online (as for live input) with given lookahead in s.",1);
+		parser.add_option("time-budget","Stop optimization after given time in s and return best solution so far.",1);
+		parser.add_option("threads","Specify number of threads running optimization restarts in parallel (in batch mode shared by all jobs).",1);
+		parser.add_option("restarts","Specify number of optimization restarts (default: 10 + 5 per syllable).",1);
+		parser.add_option("progressive","Print each improved solution during optimization.");
+		parser.add_option("precision","Specify arithmetic of the restarts: double (default), single or mixed (single, best results refined in double).",1);
+		parser.add_option("reoptimize","Re-optimize only targets next to bounds changed since the solution in given csv file.",1);
+		parser.add_option("neighbourhood","Specify number of targets on each side of a changed bound to re-optimize.",1);
+		parser.add_option("polish","Jointly refine all targets after re-optimization.");
+		parser.add_option("batch","Process all jobs of given list file (TextGrid and PitchTier file per line, tab separated).",1);
+		parser.add_option("journal","Record finished batch jobs in given file and skip them when the batch is run again.",1);
+		parser.add_option("journal-sync","Specify maximal time in s between syncs of the journal to disk.",1);
+		parser.add_option("max-attempts","Specify number of interrupted runs after which an unfinished job is given up.",1);
+		parser.set_group_name("Warm Start Options");
+		parser.add_option("warm-start","Seed restarts from solutions in given store file and add converged solutions to it.",1);
+		parser.add_option("speaker","Specify speaker key of the warm start store.",1);
+		parser.add_option("context","Specify context key of the warm start store.",1);
+		parser.add_option("warm-count","Specify number of restarts seeded from stored solutions.",1);
+		parser.set_group_name("Sweep Options");
+		parser.add_option("sweep","Optimize for each of the given comma separated values of the sweep parameter and keep the best cross-validated one.",1);
+		parser.add_option("sweep-param","Specify sweep parameter: lambda (default), m-weight, b-weight or t-weight.",1);
+		parser.add_option("folds","Specify number of syllable-level cross-validation folds.",1);
+		parser.set_group_name("Cache Options");
+		parser.add_option("cache","Reuse optimization results of unchanged inputs from given cache directory, not used with warm-start.",1);
+		parser.add_option("cache-size","Specify size limit of the cache in MB, least recently used results are evicted.",1);
+		parser.set_group_name("Instrumentation Options");
+		parser.add_option("json","Write one json line per job with results, metrics and settings to given file (- for standard output).",1);
+		parser.add_option("report","Write timings, evaluation counts and restart outcomes to given json file.",1);
+		parser.add_option("trace","Write timings as chrome trace events to given json file.",1);
+
+		// parse command line
+		parser.parse(argc,argv);
+
+		// check command line options
+		const char* one_time_opts[] = {"h", "g", "c", "p", "rate", "m-range", "b-range", "t-range", "m-weight", "b-weight", "t-weight", "online", "time-budget", "threads", "progressive", "reoptimize", "neighbourhood", "polish", "report", "trace", "batch", "json", "restarts", "warm-start", "speaker", "context", "warm-count", "cache", "cache-size", "sweep", "sweep-param", "folds", "uncertainty", "precision", "journal", "journal-sync", "max-attempts"};
+		parser.check_one_time_options(one_time_opts);
+		parser.check_option_arg_range("m-range", 0.0, 100.0);
+		parser.check_option_arg_range("b-range", 0.0, 100.0);
+		parser.check_option_arg_range("t-range", 0.0, 14.999);
+		parser.check_option_arg_range("m-weight", 0.0, 1e9);
+		parser.check_option_arg_range("b-weight", 0.0, 1e9);
+		parser.check_option_arg_range("t-weight", 0.0, 1e9);
+		parser.check_option_arg_range("lambda", 0.0, 1e15);
+		parser.check_option_arg_range("rate", 1.0, 1e6);
+		parser.check_option_arg_range("online", 0.0, 10.0);
+		parser.check_option_arg_range("time-budget", 0.0, 1e9);
+		parser.check_option_arg_range("threads", 1, 256);
+		parser.check_option_arg_range("neighbourhood", 1, 1000);
+		const char* reoptimize_sub_opts[] = {"neighbourhood", "polish"};
+		parser.check_sub_options("reoptimize", reoptimize_sub_opts);
+		parser.check_incompatible_options("batch", "reoptimize");
+		parser.check_option_arg_range("restarts", 1, 100000);
+		parser.check_option_arg_range("warm-count", 0, 1000);
+		const char* warm_start_sub_opts[] = {"speaker", "context", "warm-count"};
+		parser.check_sub_options("warm-start", warm_start_sub_opts);
+		parser.check_incompatible_options("warm-start", "online");
+		parser.check_incompatible_options("warm-start", "reoptimize");
+		const char* precision_args[] = {"double", "single", "mixed"};
+		parser.check_option_arg_range("precision", precision_args);
+		parser.check_option_arg_range("folds", 2, 1000);
+		const char* sweep_sub_opts[] = {"sweep-param", "folds"};
+		parser.check_sub_options("sweep", sweep_sub_opts);
+		const char* sweep_incompatible_opts[] = {"online", "reoptimize", "warm-start", "cache", "time-budget", "progressive", "precision"};
+		for (unsigned i=0; i<sizeof(sweep_incompatible_opts)/sizeof(sweep_incompatible_opts[0]); ++i)
+		{
+			parser.check_incompatible_options("sweep", sweep_incompatible_opts[i]);
+		}
+		parser.check_option_arg_range("cache-size", 0.001, 1e9);
+		const char* cache_sub_opts[] = {"cache-size"};
+		parser.check_sub_options("cache", cache_sub_opts);
+		parser.check_incompatible_options("cache", "online");
+		parser.check_incompatible_options("cache", "reoptimize");
+		const char* batch_sub_opts[] = {"journal"};
+		parser.check_sub_options("batch", batch_sub_opts);
+		const char* journal_sub_opts[] = {"journal-sync", "max-attempts"};
+		parser.check_sub_options("journal", journal_sub_opts);
+		parser.check_option_arg_range("journal-sync", 0.0, 1e6);
+		parser.check_option_arg_range("max-attempts", 1, 1000);
+
+		// process help option
+		if (parser.option("h"))
+		{
+			std::cout << "Usage: TargetOptimizer { <TextGrid-file> <PitchTier-file> | --batch <list-file> } { <options> | <arg> }\n";
+			parser.print_options();
+			return EXIT_SUCCESS;
+		}
+
+		// check number of default arguments
+		const bool batch = parser.option("batch");
+		if ((!batch && parser.number_of_arguments() != 2) || (batch && parser.number_of_arguments() != 0))
+		{
+			std::cout << "Error in command line:\n   You must specify two input files or a job list.\n";
+			std::cout << "\nTry the -h option for more information." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::vector<std::pair<std::string,std::string> > jobs;
+		if (batch)
+		{
+			jobs = readJobList(parser.option("batch").argument());
+		}
+		else
+		{
+			jobs.push_back(std::make_pair(parser[0], parser[1]));
+		}
+
+		// instrumentation is only active if requested
+		dlib::scoped_ptr<Profiler> profiler;
+		if (parser.option("report") || parser.option("trace"))
+		{
+			profiler.reset(new Profiler());
+			profiler->setLabel(batch ? parser.option("batch").argument() : parser[1]);
+		}
+
+		dlib::scoped_ptr<WarmStartStore> store;
+		if (parser.option("warm-start"))
+		{
+			store.reset(new WarmStartStore(parser.option("warm-start").argument()));
+		}
+
+		dlib::scoped_ptr<ResultCache> cache;
+		if (parser.option("cache"))
+		{
+			cache.reset(new ResultCache(parser.option("cache").argument(), (unsigned long long)(get_option(parser,"cache-size",0.0)*1024*1024)));
+		}
+
+		unsigned failed (0);
+		dlib::scoped_ptr<JsonLinesWriter> json;
+		if (parser.option("json"))
+		{
+			json.reset(new JsonLinesWriter(parser.option("json").argument()));
+		}
 
-			// process csv-file output option
-			if (parser.option("c"))
+		dlib::scoped_ptr<BatchJournal> journal;
+		if (parser.option("journal"))
+		{
+			journal.reset(new BatchJournal(parser.option("journal").argument(), get_option(parser,"journal-sync",5.0)));
+		}
+
+		// process jobs, a failing job does not stop the batch
+		if (batch)
+		{
+			// jobs finished by an earlier run are not repeated, their journaled results are passed on
+			std::vector<std::pair<std::string,std::string> > pending;
+			unsigned resumed (0);
+			for (unsigned j=0; j<jobs.size(); ++j)
 			{
-				CsvWriter cwriter (fileName + ".csv");
-				cwriter.writeTargets(optOnset, optTargets);
+				std::string line;
+				if (journal.get() != 0 && journal->finished(BatchJournal::makeKey(jobs[j].first, jobs[j].second), line))
+				{
+					if (json.get() != 0)
+					{
+						json->writeLine(line);
+					}
+					resumed++;
+				}
+				else
+				{
+					pending.push_back(jobs[j]);
+				}
 			}
 
-			// process PitchTarget-file output option
-			if (parser.option("p"))
+			// largest jobs first on a pool of workers, which share the restarts of running jobs when idle
+			BatchScheduler scheduler (get_option(parser,"threads",1));
+			JobRunner runner (parser, pending, profiler.get(), store.get(), cache.get(), json.get(), &scheduler.pool(), journal.get(), false);
+			scheduler.run(estimateJobCosts(pending), runner);
+			failed = runner.failed();
+
+			std::cout << "Processed " << jobs.size() << " jobs, " << failed << " failed";
+			if (journal.get() != 0)
 			{
-				PitchTierWriter pwriter (fileName + "-tam.PitchTier");
-				pwriter.writeF0(optF0);
+				journal->sync();
+				std::cout << ", " << resumed << " resumed from journal";
 			}
+			std::cout << "." << std::endl;
+		}
+		else
+		{
+			JobRunner runner (parser, jobs, profiler.get(), store.get(), cache.get(), json.get(), 0, 0, json.get() == 0);
+			runner.runJob(0);
+			failed = runner.failed();
+		}
 
-			// print results
-			std::cout << "Optimization successful.\tRMSE=" << problem.getRootMeanSquareError() << "\tCORR=" << problem.getCorrelationCoefficient() << std::endl;
-
-			return EXIT_SUCCESS;
+		// process instrumentation output options
+		if (profiler.get() != 0)
+		{
+			if (parser.option("report"))
+			{
+				profiler->writeReport(parser.option("report").argument());
+			}
+			if (parser.option("trace"))
+			{
+				profiler->writeTrace(parser.option("trace").argument());
+			}
 		}
+
+		return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 	}
 	catch (std::exception& e)
 	{
@@ -0,0 +1,31 @@
+#include <iostream>
+#include "gui.h"
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+	    // create our window
+	    MainWindow myWindow;
+
+	    // tell our window to put itself on the screen
+	    myWindow.show();
+
+	    // wait until the user closes this window before we let the program
+	    // terminate.
+	    myWindow.wait_until_closed();
+
+		// avoid console pop up on windows
+		#ifdef _MSC_VER
+		#   pragma comment( linker, "/entry:mainCRTStartup" )
+		#   pragma comment( linker, "/SUBSYSTEM:WINDOWS" )
+		#endif
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "[main] Program was terminated because an error occurred!\n" << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
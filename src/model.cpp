@@ -1,11 +1,18 @@
 #include <math.h>
 #include <string>
 #include <sstream>
+#include <set>
+#include <algorithm>
+#include <limits>
 #include <dlib/threads.h>
+#include <dlib/misc_api.h>
 #include <dlib/optimization.h>
 #include "model.h"
+#include "profiler.h"
+#include "arena.h"
+#include "scheduler.h"
 
-TamModelF0::TamModelF0 (const BoundVector &bounds)
+TamModelF0::TamModelF0 (const BoundVector &bounds) : m_engine(CLOSED_FORM)
 {
 	m_onset.time = bounds[0];
 	for (int i=1; i<bounds.size(); ++i)
@@ -26,9 +33,14 @@ void TamModelF0::setPitchTargets(const TargetVector &targets)
 	m_targets = targets;
 }
 
-TimeSignal TamModelF0::calculateF0(const double samplingPeriod) const
+void TamModelF0::setFilterEngine(const FilterEngine engine)
 {
-	TimeSignal f0;
+	m_engine = engine;
+}
+
+TimeSignal TamModelF0::calculateF0(const double samplingPeriod, Arena *arena) const
+{
+	TimeSignal f0 ((ArenaAllocator<Sample>(arena)));
 
 	// get length of signal
 	double start = m_onset.time;
@@ -40,12 +52,12 @@ TimeSignal TamModelF0::calculateF0(const double samplingPeriod) const
 
 	// sampling
 	SampleTimes times;
-	for (double t=start; t<=end; t+=samplingPeriod)
+	for (unsigned k=0; start+k*samplingPeriod<=end; ++k)
 	{
-		times.push_back(t);
+		times.push_back(start+k*samplingPeriod);
 	}
 
-	applyFilter(f0,times);
+	applyFilter(f0,times,samplingPeriod);
 	return f0;
 }
 
@@ -56,6 +68,43 @@ TimeSignal TamModelF0::calculateF0(const SampleTimes &times) const
 	return f0;
 }
 
+TimeSignal TamModelF0::calculateF0(const SampleTimes &times, const double samplingPeriod, Arena *arena) const
+{
+	TimeSignal f0 ((ArenaAllocator<Sample>(arena)));
+	applyFilter(f0,times,samplingPeriod);
+	return f0;
+}
+
+double TamModelF0::gridPeriod(const SampleTimes &times)
+{
+	// smallest time step is the candidate grid period
+	double dt (0.0);
+	for (unsigned k=1; k<times.size(); ++k)
+	{
+		double step = times[k] - times[k-1];
+		if (step <= 0.0)
+		{
+			return 0.0;
+		}
+		if (dt == 0.0 || step < dt)
+		{
+			dt = step;
+		}
+	}
+
+	// all other steps have to be multiples of it (gaps of unvoiced regions)
+	for (unsigned k=1; k<times.size(); ++k)
+	{
+		double ratio = (times[k] - times[k-1])/dt;
+		if (std::abs(ratio - std::floor(ratio + 0.5)) > 1e-6)
+		{
+			return 0.0;
+		}
+	}
+
+	return dt;
+}
+
 TargetVector TamModelF0::getPitchTargets() const
 {
 	return m_targets;
@@ -66,10 +115,24 @@ Sample TamModelF0::getOnset() const
 	return m_onset;
 }
 
-void TamModelF0::applyFilter(TimeSignal &f0, const SampleTimes &times) const
+void TamModelF0::applyFilter(TimeSignal &f0, const SampleTimes &times, const double samplingPeriod) const
 {
-	CdlpFilter lowPass(5);	// 5th order filter
-	lowPass.response(f0,times,m_targets,m_onset);
+	if (m_engine == STATE_SPACE)
+	{
+		CdlpStateSpace lowPass(FILTER_ORDER);
+		lowPass.response(f0,times,m_targets,m_onset);
+		return;
+	}
+
+	CdlpFilter lowPass(FILTER_ORDER);
+	if (samplingPeriod > 0.0)
+	{
+		lowPass.responseUniform(f0,times,samplingPeriod,m_targets,m_onset);
+	}
+	else
+	{
+		lowPass.response(f0,times,m_targets,m_onset);
+	}
 }
 
 void CdlpFilter::response (TimeSignal &f0, const SampleTimes &sampleTimes, const TargetVector &targets, const Sample onset) const
@@ -128,6 +191,97 @@ void CdlpFilter::response (TimeSignal &f0, const SampleTimes &sampleTimes, const
 	}
 }
 
+void CdlpFilter::responseUniform (TimeSignal &f0, const SampleTimes &sampleTimes, const double samplingPeriod, const TargetVector &targets, const Sample onset) const
+{
+	const unsigned& N (m_filterOrder);
+	const double& dt (samplingPeriod);
+	f0.reserve(f0.size() + sampleTimes.size());
+	if (sampleTimes.empty())
+	{
+		return;
+	}
+
+	// keep state at syllable bound
+	FilterState currentState (N, 0.0);
+	currentState[0] = onset.value;
+
+	// forward difference table of the polynomial part
+	std::vector<double> diff (N);
+
+	unsigned sampleIndex (0);
+	double bBegin = onset.time;
+	double bEnd = bBegin;
+
+	for (unsigned i=0; i<targets.size() && sampleIndex<sampleTimes.size(); ++i)
+	{
+		// update bounds
+		bBegin = bEnd;
+		bEnd = bBegin + targets[i].duration;
+
+		// filter coefficients and per step decay factor
+		FilterCoefficients c = calculateCoefficients(targets[i], currentState);
+		const double a = 1000.0/targets[i].tau;
+		const double decay = std::exp(-a*dt);
+
+		double decayState (0.0);
+		unsigned stepsSinceSync (m_resyncInterval);
+		double tPrev (0.0);
+
+		while (sampleIndex < sampleTimes.size() && sampleTimes[sampleIndex] <= bEnd)
+		{
+			double t = sampleTimes[sampleIndex] - bBegin;	// current samplePoint, time shift
+
+			if (stepsSinceSync < m_resyncInterval && std::abs(t - tPrev - dt) <= 1e-9*dt)
+			{
+				// advance on grid: additions for the polynomial, one multiplication for the exponential
+				for (unsigned n=0; n+1<N; ++n)
+				{
+					diff[n] += diff[n+1];
+				}
+				decayState *= decay;
+				stepsSinceSync++;
+			}
+			else
+			{
+				// (re-)synchronize with exact values, e.g. at gaps or to limit drift
+				for (unsigned j=0; j<N; ++j)
+				{
+					diff[j] = horner(c, t + j*dt);
+				}
+				for (unsigned n=1; n<N; ++n)
+				{
+					for (unsigned j=N-1; j>=n; --j)
+					{
+						diff[j] -= diff[j-1];
+					}
+				}
+				decayState = std::exp(-a*t);
+				stepsSinceSync = 0;
+			}
+			tPrev = t;
+
+			double value = diff[0] * decayState + targets[i].slope*t + targets[i].offset;
+			Sample s = {sampleTimes[sampleIndex], value};
+			f0.push_back(s);
+			sampleIndex++;
+		}
+
+		// update filter state
+		currentState = calculateState(currentState, bEnd, bBegin, targets[i]);
+	}
+}
+
+double CdlpFilter::horner (const FilterCoefficients &c, const double t)
+{
+	double acc (0.0);
+	for (unsigned n=c.size(); n>0; --n)
+	{
+		acc = acc*t + c[n-1];
+	}
+
+	return acc;
+}
+
 FilterCoefficients CdlpFilter::calculateCoefficients (const PitchTarget &target, const FilterState &state) const
 {
 	FilterCoefficients coeffs (state.size(), 0.0);
@@ -139,6 +293,12 @@ FilterCoefficients CdlpFilter::calculateCoefficients (const PitchTarget &target,
 		throw dlib::error(msg.str());
 	}
 
+	calculateCoefficients(target, &state[0], &coeffs[0]);
+	return coeffs;
+}
+
+void CdlpFilter::calculateCoefficients (const PitchTarget &target, const double *state, double *coeffs) const
+{
 	coeffs[0] = state[0] - target.offset;	// 0th coefficient
 	for (unsigned n=1; n<m_filterOrder; ++n)	// other coefficients
 	{
@@ -155,19 +315,21 @@ FilterCoefficients CdlpFilter::calculateCoefficients (const PitchTarget &target,
 
 		coeffs[n] = (state[n] - acc)/factorial(n);
 	}
-
-	return coeffs;
 }
 
 FilterState CdlpFilter::calculateState (const FilterState &state, const double time, const double startTime, const PitchTarget &target) const
+{
+	FilterState stateUpdate(m_filterOrder);
+	FilterCoefficients c = calculateCoefficients(target, state);
+	calculateState(&c[0], time, startTime, target, &stateUpdate[0]);
+	return stateUpdate;
+}
+
+void CdlpFilter::calculateState (const double *c, const double time, const double startTime, const PitchTarget &target, double *stateUpdate) const
 {
 	// setup
 	double t (time - startTime); // sample time
 	const unsigned& N (m_filterOrder);
-	FilterState stateUpdate(N);
-
-	// filter coefficients
-	FilterCoefficients c = calculateCoefficients(target, state);
 
 	for (unsigned n=0; n<N; ++n)
 	{
@@ -197,8 +359,6 @@ FilterState CdlpFilter::calculateState (const FilterState &state, const double t
 	{
 		stateUpdate[1] += target.slope;
 	}
-
-	return stateUpdate;
 }
 
 double CdlpFilter::binomial (const unsigned n, const unsigned k)
@@ -223,125 +383,364 @@ double CdlpFilter::factorial (unsigned n)
 	return (n == 1 || n == 0) ? 1 : factorial(n - 1) * n;
 }
 
-void OptimizationProblem::setOptimum(const double onsetVal, const TargetVector &targets)
+OptimizationProblem::OptimizationProblem (const ParameterSet &parameters, const TimeSignal &originalF0, const BoundVector &bounds, Arena *arena)
+	: m_parameters(parameters), m_originalF0(originalF0, ArenaAllocator<Sample>(arena)), m_sampleTimes(extractTimes(originalF0)), m_samplingPeriod(TamModelF0::gridPeriod(m_sampleTimes)), m_bounds(bounds, ArenaAllocator<double>(arena)),
+	  m_syllableStart(ArenaAllocator<unsigned>(arena)), m_powers(ArenaAllocator<double>(arena)), m_values(ArenaAllocator<double>(arena)), m_exactDecay(ArenaAllocator<char>(arena)), m_precision(DOUBLE_PRECISION),
+	  m_powersSingle(ArenaAllocator<float>(arena)), m_valuesSingle(ArenaAllocator<float>(arena)), m_modelOptimalF0(bounds), m_optimalSamples(ArenaAllocator<Sample>(arena))
 {
-	m_modelOptimalF0.setOnsetValue(onsetVal);
-	m_modelOptimalF0.setPitchTargets(targets);
+	FitMetrics empty = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, std::vector<double>(bounds.size()-1, 0.0)};
+	m_metrics = empty;
+	buildSampleLayout();
 }
 
-ParameterSet OptimizationProblem::getParameters() const
+void OptimizationProblem::setPrecision(const Precision precision)
 {
-	return m_parameters;
+	if (precision == MIXED_PRECISION)
+	{
+		throw dlib::error("[setPrecision] Mixed precision is an optimizer setting!");
+	}
+
+	m_precision = precision;
+	if (m_precision == SINGLE_PRECISION && m_powersSingle.empty())
+	{
+		m_powersSingle.assign(m_powers.begin(), m_powers.end());
+		m_valuesSingle.assign(m_values.begin(), m_values.end());
+	}
 }
 
-TimeSignal OptimizationProblem::getModelF0() const
+void OptimizationProblem::buildSampleLayout()
 {
-	double samplingfrequency = 200; // Hz
-	double dt = 1.0/samplingfrequency;
-	return m_modelOptimalF0.calculateF0(dt);
+	const unsigned N = FILTER_ORDER;
+	const unsigned resyncInterval = RESYNC_INTERVAL;
+	const unsigned numTargets = m_bounds.size()-1;
+	m_syllableStart.assign(numTargets+1, 0);
+
+	// assign samples to syllables like the filter does, samples beyond the last bound are not modelled
+	unsigned k (0);
+	double bBegin = m_bounds[0];
+	double bEnd = bBegin;
+	for (unsigned i=0; i<numTargets; ++i)
+	{
+		bBegin = bEnd;
+		bEnd = bBegin + (m_bounds[i+1] - m_bounds[i]);
+		m_syllableStart[i] = k;
+
+		unsigned stepsSinceSync (resyncInterval);
+		double tPrev (0.0);
+		for (; k<m_sampleTimes.size() && m_sampleTimes[k] <= bEnd; ++k)
+		{
+			const double t = m_sampleTimes[k] - bBegin;
+			double power (1.0);
+			for (unsigned n=0; n<N; ++n)
+			{
+				m_powers.push_back(power);
+				power *= t;
+			}
+
+			// on a uniform grid the exponential advances by one multiplication, exact values at gaps and to limit drift
+			const bool onGrid = m_samplingPeriod > 0.0 && stepsSinceSync < resyncInterval && std::abs(t - tPrev - m_samplingPeriod) <= 1e-9*m_samplingPeriod;
+			m_exactDecay.push_back(!onGrid);
+			m_values.push_back(m_originalF0[k].value);
+			stepsSinceSync = onGrid ? stepsSinceSync+1 : 0;
+			tPrev = t;
+		}
+	}
+	m_syllableStart[numTargets] = k;
 }
 
-TargetVector OptimizationProblem::getPitchTargets() const
+void CdlpStateSpace::response (TimeSignal &f0, const SampleTimes &sampleTimes, const TargetVector &targets, const Sample onset)
 {
-	return m_modelOptimalF0.getPitchTargets();
+	// initial state: onset value at rest
+	FilterState state (m_filterOrder, 0.0);
+	state[0] = onset.value;
+	response(f0, sampleTimes, targets, onset.time, state);
 }
 
-Sample OptimizationProblem::getOnset() const
+void CdlpStateSpace::response (TimeSignal &f0, const SampleTimes &sampleTimes, const TargetVector &targets, const double startTime, const FilterState &state)
 {
-	return m_modelOptimalF0.getOnset();
+	f0.reserve(f0.size() + sampleTimes.size());
+	if (targets.empty())
+	{
+		return;
+	}
+
+	reset(targets[0], state);
+
+	unsigned sampleIndex (0);
+	double bBegin = startTime;
+	double bEnd = bBegin + targets[0].duration;
+
+	for (unsigned i=0; i<targets.size() && sampleIndex<sampleTimes.size(); ++i)
+	{
+		if (i > 0)
+		{
+			// advance to syllable bound and switch target, the state is continuous
+			advance(bEnd - (bBegin + m_time));
+			bBegin = bEnd;
+			bEnd = bBegin + targets[i].duration;
+			setTarget(targets[i]);
+		}
+
+		// samples preceding the onset are reached by negative steps, the transition is exact
+		while (sampleIndex < sampleTimes.size() && sampleTimes[sampleIndex] <= bEnd)
+		{
+			double value = advance(sampleTimes[sampleIndex] - (bBegin + m_time));
+			Sample s = {sampleTimes[sampleIndex], value};
+			f0.push_back(s);
+			sampleIndex++;
+		}
+	}
 }
 
-SampleTimes OptimizationProblem::extractTimes(const TimeSignal &f0)
+CdlpStateSpace::CdlpStateSpace (const CdlpStateSpace &other)
+	: m_filterOrder(other.m_filterOrder), m_filter(other.m_filter), m_target(other.m_target), m_q(other.m_q), m_time(other.m_time),
+	  m_cache(other.m_cache), m_lastKey(other.m_lastKey), m_lastMatrix(0)
 {
-	SampleTimes times;
-	for (int i=0; i<f0.size(); ++i)
+}
+
+CdlpStateSpace& CdlpStateSpace::operator= (const CdlpStateSpace &other)
+{
+	m_filterOrder = other.m_filterOrder;
+	m_filter = other.m_filter;
+	m_target = other.m_target;
+	m_q = other.m_q;
+	m_time = other.m_time;
+	m_cache = other.m_cache;
+	m_lastKey = other.m_lastKey;
+	m_lastMatrix = 0;
+	return *this;
+}
+
+void CdlpStateSpace::reset (const PitchTarget &target, const FilterState &state)
+{
+	m_target = target;
+	m_time = 0.0;
+	m_q = m_filter.calculateCoefficients(target, state);
+}
+
+void CdlpStateSpace::setTarget (const PitchTarget &target)
+{
+	reset(target, getState());
+}
+
+double CdlpStateSpace::advance (const double dt)
+{
+	if (dt != 0.0)
 	{
-		times.push_back(f0[i].time);
+		// q(t+dt) = Phi(dt) * q(t)
+		const unsigned& N (m_filterOrder);
+		const TransitionMatrix& phi = transition(m_target.tau, dt);
+		for (unsigned j=0; j<N; ++j)
+		{
+			double acc (0.0);
+			for (unsigned n=j; n<N; ++n)
+			{
+				acc += phi[j*N+n]*m_q[n];
+			}
+			m_q[j] = acc;	// only entries n >= j are read in later rows
+		}
+		m_time += dt;
 	}
 
-	return times;
+	return getValue();
 }
 
-DlibVector OptimizationProblem::signal2dlibVec(const TimeSignal &f0)
+double CdlpStateSpace::getValue () const
 {
-	DlibVector values;
-	values.set_size(f0.size());
-	for (int i=0; i<f0.size(); ++i)
+	return m_q[0] + m_target.slope*m_time + m_target.offset;
+}
+
+FilterState CdlpStateSpace::getState () const
+{
+	// derivatives of the output at the current time
+	const unsigned& N (m_filterOrder);
+	const double a = 1000.0/m_target.tau;
+	FilterState state (N, 0.0);
+	for (unsigned k=0; k<N; ++k)
+	{
+		double acc (0.0);
+		for (unsigned j=0; j<=k; ++j)
+		{
+			acc += CdlpFilter::binomial(k,j)*std::pow(-a,k-j)*CdlpFilter::factorial(j)*m_q[j];
+		}
+		state[k] = acc;
+	}
+
+	// correction for linear targets
+	state[0] += m_target.offset + m_target.slope*m_time;
+	if (N > 1)
 	{
-		values(i) = f0[i].value;
+		state[1] += m_target.slope;
 	}
 
-	return values;
+	return state;
 }
 
-double OptimizationProblem::getCorrelationCoefficient() const
+const TransitionMatrix& CdlpStateSpace::transition (const double tau, const double dt)
 {
-	SampleTimes times = extractTimes(m_originalF0);
-	TimeSignal modelF0 = m_modelOptimalF0.calculateF0(times);
+	std::pair<double,double> key (tau, dt);
+	if (m_lastMatrix != 0 && key == m_lastKey)
+	{
+		return *m_lastMatrix;
+	}
 
-	// Dlib format
-	DlibVector orig = signal2dlibVec(m_originalF0);
-	DlibVector model = signal2dlibVec(modelF0);
+	// limit memory on irregularly sampled signals
+	if (m_cache.size() > 1024)
+	{
+		m_cache.clear();
+	}
 
-	// return correlation between filtered and original f0
-	DlibVector x = orig - dlib::mean(orig);
-	DlibVector y = model - dlib::mean(model);
-	return (dlib::dot(x,y)) / ( (std::sqrt( dlib::sum(dlib::squared(x))) ) * (std::sqrt( dlib::sum(dlib::squared(y))) ) );
+	std::map<std::pair<double,double>, TransitionMatrix>::iterator it = m_cache.find(key);
+	if (it == m_cache.end())
+	{
+		// Phi[j][n] = exp(-dt/tau) * binomial(n,j) * dt^(n-j) for n >= j
+		const unsigned& N (m_filterOrder);
+		const double decay = std::exp(-(1000.0/tau)*dt);
+		TransitionMatrix phi (N*N, 0.0);
+		for (unsigned j=0; j<N; ++j)
+		{
+			for (unsigned n=j; n<N; ++n)
+			{
+				phi[j*N+n] = decay * CdlpFilter::binomial(n,j) * std::pow(dt,n-j);
+			}
+		}
+		it = m_cache.insert(std::make_pair(key, phi)).first;
+	}
 
+	m_lastKey = key;
+	m_lastMatrix = &it->second;
+	return it->second;
 }
 
-double OptimizationProblem::getRootMeanSquareError() const
+IncrementalModelF0::IncrementalModelF0 (const BoundVector &bounds, const double samplingPeriod)
+	: m_bounds(bounds), m_times(bounds.size()-1), m_segments(bounds.size()-1)
 {
-	SampleTimes times = extractTimes(m_originalF0);
-	TimeSignal modelF0 = m_modelOptimalF0.calculateF0(times);
+	m_onset.time = bounds[0];
+	m_onset.value = 0.0;
 
-	// Dlib format
-	DlibVector orig = signal2dlibVec(m_originalF0);
-	DlibVector model = signal2dlibVec(modelF0);
+	// same grid as TamModelF0::calculateF0, split at syllable bounds
+	unsigned i (0);
+	for (unsigned k=0; bounds[0]+k*samplingPeriod<=bounds.back(); ++k)
+	{
+		double t = bounds[0]+k*samplingPeriod;
+		while (t > bounds[i+1])
+		{
+			++i;
+		}
+		m_times[i].push_back(t);
+	}
+}
+
+void IncrementalModelF0::setModel (const double onsetVal, const TargetVector &targets)
+{
+	m_onset.value = onsetVal;
+	m_targets = targets;
+	m_states.assign(m_bounds.size(), FilterState(FILTER_ORDER, 0.0));
+	m_states[0][0] = onsetVal;
+	update(0);
+}
 
-	// return RMSE between filtered and original f0
-	return std::sqrt(dlib::mean(dlib::squared(model - orig)));
+void IncrementalModelF0::setPitchTarget (const unsigned index, const PitchTarget &target)
+{
+	m_targets[index] = target;
+	update(index);
 }
 
-double OptimizationProblem::operator() (const DlibVector& arg) const
+TimeSignal IncrementalModelF0::getF0 () const
+{
+	TimeSignal f0;
+	for (unsigned i=0; i<m_segments.size(); ++i)
+	{
+		f0.insert(f0.end(), m_segments[i].begin(), m_segments[i].end());
+	}
+
+	return f0;
+}
+
+TargetVector IncrementalModelF0::getPitchTargets () const
+{
+	return m_targets;
+}
+
+Sample IncrementalModelF0::getOnset () const
+{
+	return m_onset;
+}
+
+void IncrementalModelF0::update (const unsigned first)
+{
+	// syllables before the changed one are not affected
+	CdlpFilter filter (FILTER_ORDER);
+	CdlpStateSpace lowPass (FILTER_ORDER);
+	for (unsigned i=first; i<m_targets.size(); ++i)
+	{
+		TargetVector target (1, m_targets[i]);
+		m_segments[i].clear();
+		lowPass.response(m_segments[i], m_times[i], target, m_bounds[i], m_states[i]);
+		m_states[i+1] = filter.calculateState(m_states[i], m_bounds[i+1], m_bounds[i], m_targets[i]);
+	}
+}
+
+SegmentProblem::SegmentProblem (const ParameterSet &parameters, const TimeSignal &f0, const double startTime, const FilterState &state, const std::vector<double> &durations, const bool optimizeOnset)
+	: m_parameters(parameters), m_f0(f0), m_startTime(startTime), m_state(state), m_durations(durations), m_optimizeOnset(optimizeOnset), m_lowPass(state.size())
+{
+	for (unsigned k=0; k<f0.size(); ++k)
+	{
+		m_sampleTimes.push_back(f0[k].time);
+	}
+}
+
+unsigned SegmentProblem::numParameters() const
+{
+	return 3*m_durations.size() + (m_optimizeOnset ? 1 : 0);
+}
+
+TargetVector SegmentProblem::getPitchTargets(const DlibVector& arg) const
 {
-	// convert data
+	unsigned first = m_optimizeOnset ? 1 : 0;
 	TargetVector targets;
-	for (int i=0; i<arg.size()/3; ++i)
+	for (unsigned i=0; i<m_durations.size(); ++i)
 	{
 		PitchTarget pt;
-		pt.slope = arg(3*i+1);
-		pt.offset = arg(3*i+2);
-		pt.tau = arg(3*i+3);
-		pt.duration = m_bounds[i+1] - m_bounds[i];
+		pt.slope = arg(first+3*i);
+		pt.offset = arg(first+3*i+1);
+		pt.tau = arg(first+3*i+2);
+		pt.duration = m_durations[i];
 		targets.push_back(pt);
 	}
 
-	// create model f0
-	TamModelF0 tamF0 (m_bounds);
-	tamF0.setOnsetValue(arg(0));
-	tamF0.setPitchTargets(targets);
+	return targets;
+}
+
+FilterState SegmentProblem::getInitialState(const DlibVector& arg) const
+{
+	FilterState state (m_state);
+	if (m_optimizeOnset)
+	{
+		state[0] = arg(0);
+	}
 
-	return costFunction(tamF0);
+	return state;
 }
 
-double OptimizationProblem::costFunction(const TamModelF0 &tamF0) const
+double SegmentProblem::operator() (const DlibVector& arg) const
 {
-	// get model f0
-	SampleTimes times = extractTimes(m_originalF0);
-	TimeSignal modelF0 = tamF0.calculateF0(times);
+	TargetVector targets = getPitchTargets(arg);
+
+	// model f0 starting from the given filter state
+	TimeSignal modelF0;
+	m_lowPass.response(modelF0, m_sampleTimes, targets, m_startTime, getInitialState(arg));
 
 	// calculate error
 	double error = 0.0;
-	for (int i=0; i<modelF0.size(); ++i)
+	for (unsigned k=0; k<modelF0.size(); ++k)
 	{
-		error += std::pow((m_originalF0[i].value - modelF0[i].value),2.0);
+		error += std::pow((m_f0[k].value - modelF0[k].value),2.0);
 	}
 
 	// calculate penalty term
 	double penalty = 0.0;
-	TargetVector targets = tamF0.getPitchTargets();
-	for (int i=0; i<targets.size(); ++i)
+	for (unsigned i=0; i<targets.size(); ++i)
 	{
 		penalty += (m_parameters.weightSlope * std::pow(targets[i].slope - m_parameters.meanSlope, 2.0));
 		penalty += (m_parameters.weightOffset * std::pow(targets[i].offset - m_parameters.meanOffset, 2.0));
@@ -351,109 +750,1431 @@ double OptimizationProblem::costFunction(const TamModelF0 &tamF0) const
 	return error + m_parameters.lambda*penalty;
 }
 
-void BobyqaOptimizer::optimize(OptimizationProblem& op, const unsigned randIters) const
+OnlineTargetEstimator::OnlineTargetEstimator (const ParameterSet &parameters, const double lookahead, const unsigned randIters)
+	: m_parameters(parameters), m_lookahead(lookahead), m_randIters(randIters), m_currentTime(-1e9), m_started(false), m_random(time(NULL))
 {
-	int numTar = op.getPitchTargets().size();
-	ParameterSet ps = op.getParameters();
+	m_onset.time = 0.0;
+	m_onset.value = parameters.meanOffset;
+}
 
-	// precalculate bounds
-	double mmin = ps.meanSlope-ps.deltaSlope;
-	double bmin = ps.meanOffset-ps.deltaOffset;
-	double tmin = ps.meanTau-ps.deltaTau;
-	double mmax = ps.meanSlope+ps.deltaSlope;
-	double bmax = ps.meanOffset+ps.deltaOffset;
-	double tmax = ps.meanTau+ps.deltaTau;
+void OnlineTargetEstimator::addSample (const Sample &s)
+{
+	if (!m_samples.empty() && s.time <= m_samples.back().time)
+	{
+		throw dlib::error("[addSample] Samples have to be added in increasing time order!");
+	}
 
-	DlibVector lowerBound, upperBound;
-	lowerBound.set_size(numTar*3 + 1);
-	upperBound.set_size(numTar*3 + 1);
-	lowerBound(0) = bmin;
-	upperBound(0) = bmax;
+	m_samples.push_back(s);
+	m_currentTime = std::max(m_currentTime, s.time);
+	update(false);
+}
 
-	for (unsigned i=0; i<numTar; ++i)
+void OnlineTargetEstimator::addBound (const double time)
+{
+	if (!m_bounds.empty() && time <= m_bounds.back())
 	{
-		lowerBound(3*i+1) = mmin;
-		lowerBound(3*i+2) = bmin;
-		lowerBound(3*i+3) = tmin;
-		upperBound(3*i+1) = mmax;
-		upperBound(3*i+2) = bmax;
-		upperBound(3*i+3) = tmax;
+		throw dlib::error("[addBound] Syllable bounds have to be added in increasing time order!");
 	}
 
-	// optmization setup
-	long npt (2*lowerBound.size()+1);	// number of interpolation points
-	const double rho_begin ((std::min(std::min(mmax-mmin, bmax-bmin),tmax-tmin)-1.0)/2.0); // initial trust region radius
-	const double rho_end (1e-6); // stopping trust region radius -> accuracy
-	const long max_f_evals (1e6); // max number of objective function evaluations
+	if (!m_started && m_bounds.empty())
+	{
+		m_onset.time = time;
+	}
+
+	m_bounds.push_back(time);
+	m_currentTime = std::max(m_currentTime, time);
+	update(false);
+}
 
-	// initialize
-	double fmin (1e6);
-	DlibVector xtmp; double ftmp;
-	unsigned itNum (randIters+numTar*5);
-	dlib::mutex mu;
+void OnlineTargetEstimator::finish ()
+{
+	update(true);
+}
+
+bool OnlineTargetEstimator::hasTarget () const
+{
+	return !m_targets.empty();
+}
 
-	for (int it=0; it<itNum; ++it)
+PitchTarget OnlineTargetEstimator::nextTarget ()
+{
+	if (m_targets.empty())
 	{
-		// random initialization
-		DlibVector x;
-		x.set_size(numTar*3 + 1);
-		x(0) = getRandomValue(ps.meanOffset-ps.deltaOffset, ps.meanOffset+ps.deltaOffset);
+		throw dlib::error("[nextTarget] No pitch target available!");
+	}
+
+	PitchTarget pt = m_targets.front();
+	m_targets.pop_front();
+	return pt;
+}
+
+Sample OnlineTargetEstimator::getOnset () const
+{
+	return m_onset;
+}
+
+FilterState OnlineTargetEstimator::getState () const
+{
+	return m_state;
+}
+
+void OnlineTargetEstimator::update (const bool final)
+{
+	// a syllable is complete if both bounds are known and the lookahead has elapsed
+	while (m_bounds.size() > 1 && (final || m_currentTime >= m_bounds[1] + m_lookahead))
+	{
+		estimate(final);
+	}
+}
+
+void OnlineTargetEstimator::estimate (const bool final)
+{
+	// current syllable plus a provisional one covering the lookahead
+	std::vector<double> durations (1, m_bounds[1] - m_bounds[0]);
+	double windowEnd = m_bounds[1];
+	if (!final && m_lookahead > 0.0)
+	{
+		windowEnd = (m_bounds.size() > 2) ? std::min(m_bounds[2], m_currentTime) : m_currentTime;
+		if (windowEnd > m_bounds[1])
+		{
+			durations.push_back(windowEnd - m_bounds[1]);
+		}
+	}
+
+	// samples within window; those before the first bound belong to the first syllable
+	TimeSignal window;
+	for (unsigned k=0; k<m_samples.size() && m_samples[k].time <= windowEnd; ++k)
+	{
+		if (m_started && m_samples[k].time <= m_bounds[0])
+			continue;
+		window.push_back(m_samples[k]);
+	}
+
+	FilterState state (m_state);
+	if (!m_started)
+	{
+		state.assign(FILTER_ORDER, 0.0);
+		state[0] = m_parameters.meanOffset;
+	}
+	SegmentProblem problem (m_parameters, window, m_bounds[0], state, durations, !m_started);
+
+	// search space
+	const ParameterSet& ps = m_parameters;
+	unsigned first = m_started ? 0 : 1;
+	DlibVector lowerBound, upperBound, x, xopt;
+	lowerBound.set_size(problem.numParameters());
+	upperBound.set_size(problem.numParameters());
+	if (!m_started)
+	{
+		lowerBound(0) = ps.meanOffset-ps.deltaOffset;
+		upperBound(0) = ps.meanOffset+ps.deltaOffset;
+	}
+	for (unsigned i=0; i<durations.size(); ++i)
+	{
+		lowerBound(first+3*i) = ps.meanSlope-ps.deltaSlope;
+		lowerBound(first+3*i+1) = ps.meanOffset-ps.deltaOffset;
+		lowerBound(first+3*i+2) = ps.meanTau-ps.deltaTau;
+		upperBound(first+3*i) = ps.meanSlope+ps.deltaSlope;
+		upperBound(first+3*i+1) = ps.meanOffset+ps.deltaOffset;
+		upperBound(first+3*i+2) = ps.meanTau+ps.deltaTau;
+	}
+
+	// optmization setup (see BobyqaOptimizer)
+	long npt (2*lowerBound.size()+1);
+	const double rho_begin ((std::min(std::min(2*ps.deltaSlope, 2*ps.deltaOffset),2*ps.deltaTau)-1.0)/2.0);
+	const double rho_end (1e-6);
+	const long max_f_evals (1e6);
+
+	// first start at the center of the search space, then random restarts
+	double fmin (-1.0);
+	for (unsigned it=0; it<m_randIters+1; ++it)
+	{
+		x = (lowerBound + upperBound)/2.0;
+		for (long j=0; it>0 && j<x.size(); ++j)
+		{
+			x(j) = lowerBound(j) + m_random.get_random_double()*(upperBound(j)-lowerBound(j));
+		}
+
+		try
+		{
+			double ftmp = dlib::find_min_bobyqa(problem,x,npt,lowerBound,upperBound,rho_begin,rho_end,max_f_evals);
+			if (fmin < 0.0 || ftmp < fmin)
+			{
+				fmin = ftmp;
+				xopt = x;
+			}
+		}
+		catch (dlib::bobyqa_failure& err)
+		{
+			// DEBUG message
+			#ifdef DEBUG_MSG
+			std::cout << "\t[estimate] WARNING: no convergence during optimization in iteration: " << it << std::endl << err.info << std::endl;
+			#endif
+		}
+	}
+
+	if (fmin < 0.0)
+	{
+		throw dlib::error("[estimate] BOBYQA algorithms didn't converge!");
+	}
+
+	// fix target of current syllable and carry the filter state to its end
+	PitchTarget target = problem.getPitchTargets(xopt)[0];
+	state = problem.getInitialState(xopt);
+	if (!m_started)
+	{
+		m_onset.value = state[0];
+		m_started = true;
+	}
+	CdlpStateSpace lowPass (state.size());
+	lowPass.reset(target, state);
+	lowPass.advance(target.duration);
+	m_state = lowPass.getState();
+	m_targets.push_back(target);
+
+	// drop consumed input
+	while (!m_samples.empty() && m_samples.front().time <= m_bounds[1])
+	{
+		m_samples.pop_front();
+	}
+	m_bounds.pop_front();
+}
+
+void OptimizationProblem::setOptimum(const double onsetVal, const TargetVector &targets)
+{
+	m_modelOptimalF0.setOnsetValue(onsetVal);
+	m_modelOptimalF0.setPitchTargets(targets);
+
+	// model output at original sample times is needed by all metrics, calculate it once
+	m_optimalSamples = m_modelOptimalF0.calculateF0(m_sampleTimes, m_samplingPeriod, m_bounds.get_allocator().arena());
+	calculateFitMetrics();
+}
+
+ParameterSet OptimizationProblem::getParameters() const
+{
+	return m_parameters;
+}
+
+TimeSignal OptimizationProblem::getModelF0(const double samplingFrequency) const
+{
+	double dt = 1.0/samplingFrequency;
+	return m_modelOptimalF0.calculateF0(dt, m_bounds.get_allocator().arena());
+}
+
+TargetVector OptimizationProblem::getPitchTargets() const
+{
+	return m_modelOptimalF0.getPitchTargets();
+}
+
+Sample OptimizationProblem::getOnset() const
+{
+	return m_modelOptimalF0.getOnset();
+}
+
+SampleTimes OptimizationProblem::extractTimes(const TimeSignal &f0)
+{
+	SampleTimes times;
+	for (int i=0; i<f0.size(); ++i)
+	{
+		times.push_back(f0[i].time);
+	}
+
+	return times;
+}
+
+double OptimizationProblem::getCorrelationCoefficient() const
+{
+	return m_metrics.correlation;
+}
+
+double OptimizationProblem::getRootMeanSquareError() const
+{
+	return m_metrics.rmse;
+}
+
+FitMetrics OptimizationProblem::getFitMetrics() const
+{
+	return m_metrics;
+}
+
+ParameterUncertainty OptimizationProblem::estimateUncertainty() const
+{
+	const TargetVector targets = m_modelOptimalF0.getPitchTargets();
+	const Sample onset = m_modelOptimalF0.getOnset();
+	const unsigned n = targets.size();
+	const unsigned p = 3*n+1;
+	const unsigned K = std::min(m_optimalSamples.size(), m_originalF0.size());
+
+	ParameterUncertainty pu;
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	TargetUncertainty unknown = {nan, nan, nan, nan, nan, nan};
+	pu.onset = nan;
+	pu.targets.assign(n, unknown);
+	pu.residualVariance = m_metrics.squaredError / std::max<int>((int)K-(int)p, 1);
+	pu.evaluations = 0;
+	if (K == 0)
+	{
+		return pu;
+	}
+
+	// first sample of each syllable, assigned like the filter does
+	std::vector<unsigned> first (n, K);
+	first[0] = 0;
+	for (unsigned k=0, i=0; k<K; ++k)
+	{
+		while (m_sampleTimes[k] > m_bounds[i+1] && i+1 < n)
+		{
+			first[++i] = k;
+		}
+	}
+
+	// filter states at the syllable bounds
+	CdlpFilter filter;
+	std::vector<FilterState> states (n, FilterState(FILTER_ORDER, 0.0));
+	states[0][0] = onset.value;
+	for (unsigned i=0; i+1<n; ++i)
+	{
+		states[i+1] = filter.calculateState(states[i], m_bounds[i+1], m_bounds[i], targets[i]);
+	}
+
+	// jacobian of the model f0 by central differences; targets only affect the model from their
+	// own syllable on, so a column is recalculated from the cached state at its bound
+	dlib::matrix<double> J = dlib::zeros_matrix<double>(K, p);
+	for (unsigned c=0; c<p; ++c)
+	{
+		const unsigned j = (c > 0) ? (c-1)/3 : 0;
+		double *param = 0;
+		TargetVector perturbed = targets;
+		double onsetValue = onset.value;
+		switch (c == 0 ? 0 : (c-1)%3 + 1)
+		{
+			case 0: param = &onsetValue; break;
+			case 1: param = &perturbed[j].slope; break;
+			case 2: param = &perturbed[j].offset; break;
+			case 3: param = &perturbed[j].tau; break;
+		}
+		const double x = *param;
+		const double h = 1e-5*std::max(1.0, std::fabs(x));
+
+		TimeSignal f0[2];
+		for (unsigned s=0; s<2; ++s)
+		{
+			*param = (s == 0) ? x+h : x-h;
+			if (c == 0 || j == 0)
+			{
+				TamModelF0 tamF0 (m_bounds);
+				tamF0.setOnsetValue(onsetValue);
+				tamF0.setPitchTargets(perturbed);
+				f0[s] = tamF0.calculateF0(m_sampleTimes, m_samplingPeriod);
+			}
+			else
+			{
+				SampleTimes times (m_sampleTimes.begin()+first[j], m_sampleTimes.begin()+K);
+				TargetVector following (perturbed.begin()+j, perturbed.end());
+				CdlpStateSpace lowPass;
+				lowPass.response(f0[s], times, following, m_bounds[j], states[j]);
+			}
+			pu.evaluations++;
+		}
+
+		const unsigned row0 = (c == 0 || j == 0) ? 0 : first[j];
+		for (unsigned k=0; k<f0[0].size() && k<f0[1].size() && row0+k<K; ++k)
+		{
+			J(row0+k, c) = (f0[0][k].value - f0[1][k].value) / (2.0*h);
+		}
+	}
+
+	// gauss-newton hessian, the penalty adds a diagonal prior
+	dlib::matrix<double> H = dlib::trans(J)*J;
+	for (unsigned i=0; i<n; ++i)
+	{
+		H(3*i+1, 3*i+1) += m_parameters.lambda * m_parameters.weightSlope;
+		H(3*i+2, 3*i+2) += m_parameters.lambda * m_parameters.weightOffset;
+		H(3*i+3, 3*i+3) += m_parameters.lambda * m_parameters.weightTau;
+	}
+
+	// scale to unit diagonal, parameters have different units
+	dlib::matrix<double,0,1> d (p);
+	for (unsigned c=0; c<p; ++c)
+	{
+		if (!(H(c,c) > 0.0))
+		{
+			return pu; // parameter does not affect the cost
+		}
+		d(c) = 1.0/std::sqrt(H(c,c));
+	}
+	dlib::matrix<double> S = dlib::diagm(d) * H * dlib::diagm(d);
+	dlib::cholesky_decomposition<dlib::matrix<double> > chol (S);
+	if (!chol.is_spd())
+	{
+		return pu;
+	}
+	dlib::matrix<double> cov = pu.residualVariance * dlib::diagm(d) * chol.solve(dlib::identity_matrix<double>(p)) * dlib::diagm(d);
+
+	pu.onset = std::sqrt(cov(0,0));
+	for (unsigned i=0; i<n; ++i)
+	{
+		const unsigned c = 3*i+1;
+		TargetUncertainty &tu = pu.targets[i];
+		tu.slope = std::sqrt(cov(c,c));
+		tu.offset = std::sqrt(cov(c+1,c+1));
+		tu.tau = std::sqrt(cov(c+2,c+2));
+		tu.corrSlopeOffset = cov(c,c+1) / (tu.slope*tu.offset);
+		tu.corrSlopeTau = cov(c,c+2) / (tu.slope*tu.tau);
+		tu.corrOffsetTau = cov(c+1,c+2) / (tu.offset*tu.tau);
+	}
+
+	return pu;
+}
+
+void OptimizationProblem::calculateFitMetrics()
+{
+	const TargetVector &targets = m_modelOptimalF0.getPitchTargets();
+	FitMetrics &fm = m_metrics;
+	fm.syllableRmse.assign(targets.size(), 0.0);
+	fm.squaredError = 0.0;
+	fm.maxError = 0.0;
+
+	// model f0 ends at last syllable bound, samples beyond are ignored (like in cost function)
+	unsigned K = std::min(m_optimalSamples.size(), m_originalF0.size());
+
+	// single pass over all samples: error moments and shifted sums for correlation
+	double shift = (K > 0) ? m_originalF0[0].value : 0.0;
+	double sumOrig (0.0), sumModel (0.0), sumOrigSq (0.0), sumModelSq (0.0), sumCross (0.0);
+	std::vector<unsigned> syllableCount (targets.size(), 0);
+	unsigned syllable (0);
+	double bEnd = m_modelOptimalF0.getOnset().time + (targets.empty() ? 0.0 : targets[0].duration);
+	for (unsigned k=0; k<K; ++k)
+	{
+		double orig = m_originalF0[k].value;
+		double model = m_optimalSamples[k].value;
+		double err = model - orig;
+
+		// assign sample to syllable the same way the filter does
+		while (m_sampleTimes[k] > bEnd && syllable+1 < targets.size())
+		{
+			bEnd += targets[++syllable].duration;
+		}
+
+		fm.squaredError += err*err;
+		fm.maxError = std::max(fm.maxError, std::abs(err));
+		if (!targets.empty())
+		{
+			fm.syllableRmse[syllable] += err*err;
+			syllableCount[syllable]++;
+		}
+
+		orig -= shift;
+		model -= shift;
+		sumOrig += orig;
+		sumModel += model;
+		sumOrigSq += orig*orig;
+		sumModelSq += model*model;
+		sumCross += orig*model;
+	}
+
+	for (unsigned i=0; i<fm.syllableRmse.size(); ++i)
+	{
+		if (syllableCount[i] > 0)
+		{
+			fm.syllableRmse[i] = std::sqrt(fm.syllableRmse[i]/syllableCount[i]);
+		}
+	}
+
+	fm.rmse = (K > 0) ? std::sqrt(fm.squaredError/K) : 0.0;
+	double covariance = sumCross - sumOrig*sumModel/K;
+	double varOrig = sumOrigSq - sumOrig*sumOrig/K;
+	double varModel = sumModelSq - sumModel*sumModel/K;
+	fm.correlation = (K > 0) ? covariance / (std::sqrt(varOrig) * std::sqrt(varModel)) : 0.0;
+
+	// penalty breakdown
+	fm.penaltySlope = fm.penaltyOffset = fm.penaltyTau = 0.0;
+	for (unsigned i=0; i<targets.size(); ++i)
+	{
+		fm.penaltySlope += (m_parameters.weightSlope * std::pow(targets[i].slope - m_parameters.meanSlope, 2.0));
+		fm.penaltyOffset += (m_parameters.weightOffset * std::pow(targets[i].offset - m_parameters.meanOffset, 2.0));
+		fm.penaltyTau += (m_parameters.weightTau * std::pow(targets[i].tau - m_parameters.meanTau, 2.0));
+	}
+	fm.penalty = m_parameters.lambda * (fm.penaltySlope + fm.penaltyOffset + fm.penaltyTau);
+}
+
+double OptimizationProblem::operator() (const DlibVector& arg) const
+{
+	// a batch of one candidate, laid out in the thread's arena
+	const unsigned numTargets = arg.size()/3;
+	Arena &arena = Arena::local();
+	Arena::Scope scope (arena);
+	double *slope = arena.allocate<double>(3*numTargets);
+	double *offset = slope + numTargets;
+	double *tau = offset + numTargets;
+	for (unsigned i=0; i<numTargets; ++i)
+	{
+		slope[i] = arg(3*i+1);
+		offset[i] = arg(3*i+2);
+		tau[i] = arg(3*i+3);
+	}
+
+	const double onset = arg(0);
+	double cost (0.0);
+	evaluateLanes(1, &onset, slope, offset, tau, &cost);
+	return cost;
+}
+
+// squared errors of the samples [begin,end) of one syllable, lanes run across the K candidates
+template <typename T>
+static void accumulateSyllable (const unsigned K, const unsigned begin, const unsigned end, const T *powers, const T *f0, const char *exactDecay,
+	const T *c, const T *a, const T *decay, const T *slope, const T *offset, T *e, double *cost)
+{
+	const unsigned N = FILTER_ORDER;
+	for (unsigned s=begin; s<end; ++s)
+	{
+		// dot product with the precomputed time powers and one exponential per sample
+		const T *tpow = &powers[N*s];
+		const T t = tpow[1];
+		if (exactDecay[s])
+		{
+			for (unsigned k=0; k<K; ++k)
+			{
+				e[k] = std::exp(-a[k]*t);
+			}
+		}
+		else
+		{
+			for (unsigned k=0; k<K; ++k)
+			{
+				e[k] *= decay[k];
+			}
+		}
+
+		for (unsigned k=0; k<K; ++k)
+		{
+			T poly = c[k];
+			for (unsigned n=1; n<N; ++n)
+			{
+				poly += c[n*K+k]*tpow[n];
+			}
+			const T err = f0[s] - (poly*e[k] + slope[k]*t + offset[k]);
+			cost[k] += err*err;
+		}
+	}
+}
+
+std::vector<double> OptimizationProblem::evaluateBatch(const CandidateBatch &batch) const
+{
+	const unsigned K = batch.size;
+	const unsigned numTargets = m_bounds.size()-1;
+	if (batch.onset.size() != K || batch.slope.size() != numTargets*K || batch.offset.size() != numTargets*K || batch.tau.size() != numTargets*K)
+	{
+		throw dlib::error("[evaluateBatch] Wrong size of candidate batch!");
+	}
+
+	std::vector<double> cost (K, 0.0);
+	if (K > 0)
+	{
+		evaluateLanes(K, &batch.onset[0], &batch.slope[0], &batch.offset[0], &batch.tau[0], &cost[0]);
+	}
+
+	return cost;
+}
+
+void OptimizationProblem::evaluateLanes(const unsigned K, const double *onset, const double *slopes, const double *offsets, const double *taus, double *cost) const
+{
+	const unsigned numTargets = m_bounds.size()-1;
+	const unsigned N = FILTER_ORDER;
+
+	// scratch lives until the end of the evaluation, the arena is rewound on return
+	Arena &arena = Arena::local();
+	Arena::Scope scope (arena);
+
+	// filter state of each candidate at the current syllable bound, initially at rest (state of candidate k at k*N)
+	CdlpFilter filter (N);
+	double *states = arena.allocate<double>(N*K);
+	std::fill(states, states + N*K, 0.0);
+	for (unsigned k=0; k<K; ++k)
+	{
+		states[N*k] = onset[k];
+	}
+
+	// per candidate lanes: polynomial coefficients (coefficient n of candidate k at n*K+k), decay rates and exponentials
+	double *coeffs = arena.allocate<double>(N*K); // coefficients of candidate k at k*N
+	double *c = arena.allocate<double>(N*K);
+	double *a = arena.allocate<double>(K);
+	double *decay = arena.allocate<double>(K);
+	double *e = arena.allocate<double>(K);
+
+	// single precision copies of the lanes
+	const bool single = (m_precision == SINGLE_PRECISION);
+	float *cs (0), *as (0), *decays (0), *es (0), *slopesSingle (0), *offsetsSingle (0);
+	if (single)
+	{
+		cs = arena.allocate<float>(N*K);
+		as = arena.allocate<float>(K);
+		decays = arena.allocate<float>(K);
+		es = arena.allocate<float>(K);
+		slopesSingle = arena.allocate<float>(K);
+		offsetsSingle = arena.allocate<float>(K);
+	}
+
+	double bBegin = m_bounds[0];
+	double bEnd = bBegin;
+	for (unsigned i=0; i<numTargets && m_syllableStart[i]<m_syllableStart[numTargets]; ++i)
+	{
+		// update bounds like the filter does
+		bBegin = bEnd;
+		bEnd = bBegin + (m_bounds[i+1] - m_bounds[i]);
+
+		// coefficients are calculated once per syllable, always in double
+		const double *slope = &slopes[i*K];
+		const double *offset = &offsets[i*K];
+		const double *tau = &taus[i*K];
+		for (unsigned k=0; k<K; ++k)
+		{
+			PitchTarget pt = {slope[k], offset[k], tau[k], bEnd-bBegin};
+			filter.calculateCoefficients(pt, &states[N*k], &coeffs[N*k]);
+			for (unsigned n=0; n<N; ++n)
+			{
+				c[n*K+k] = coeffs[N*k+n];
+			}
+			a[k] = 1000.0/tau[k];
+			decay[k] = std::exp(-a[k]*m_samplingPeriod);
+		}
+
+		const unsigned begin = m_syllableStart[i];
+		const unsigned end = m_syllableStart[i+1];
+		if (single && begin < end && singleConditioned(K, c, a, m_powers[N*begin+1], m_powers[N*(end-1)+1]))
+		{
+			for (unsigned k=0; k<K; ++k)
+			{
+				for (unsigned n=0; n<N; ++n)
+				{
+					cs[n*K+k] = c[n*K+k];
+				}
+				as[k] = a[k];
+				decays[k] = decay[k];
+				slopesSingle[k] = slope[k];
+				offsetsSingle[k] = offset[k];
+			}
+			accumulateSyllable<float>(K, begin, end, &m_powersSingle[0], &m_valuesSingle[0], &m_exactDecay[0], cs, as, decays, slopesSingle, offsetsSingle, es, cost);
+		}
+		else if (begin < end)
+		{
+			accumulateSyllable<double>(K, begin, end, &m_powers[0], &m_values[0], &m_exactDecay[0], c, a, decay, slope, offset, e, cost);
+		}
+
+		// the coefficients of the syllable give the state at its end
+		for (unsigned k=0; k<K; ++k)
+		{
+			PitchTarget pt = {slope[k], offset[k], tau[k], bEnd-bBegin};
+			filter.calculateState(&coeffs[N*k], bEnd, bBegin, pt, &states[N*k]);
+		}
+	}
+
+	// penalty term
+	for (unsigned j=0; j<numTargets*K; ++j)
+	{
+		double penalty = m_parameters.weightSlope * std::pow(slopes[j] - m_parameters.meanSlope, 2.0)
+			+ m_parameters.weightOffset * std::pow(offsets[j] - m_parameters.meanOffset, 2.0)
+			+ m_parameters.weightTau * std::pow(taus[j] - m_parameters.meanTau, 2.0);
+		cost[j%K] += m_parameters.lambda*penalty;
+	}
+}
+
+bool OptimizationProblem::singleConditioned(const unsigned K, const double *c, const double *a, const double tBegin, const double tEnd)
+{
+	// samples before the onset let the exponential grow
+	if (tBegin < 0.0)
+	{
+		return false;
+	}
+
+	// float rounding of the polynomial, relative to the magnitude of its terms damped by the exponential;
+	// |t^n*exp(-a*t)| peaks at t = n/a, tiny tau and long segments lead to cancellation or exponent underflow
+	const unsigned N = FILTER_ORDER;
+	const double tolerance = 1e-3; // [st]
+	const double epsilon = std::numeric_limits<float>::epsilon();
+	for (unsigned k=0; k<K; ++k)
+	{
+		if (a[k]*tEnd > 80.0)
+		{
+			return false;
+		}
+
+		double magnitude = std::abs(c[k]);
+		for (unsigned n=1; n<N; ++n)
+		{
+			const double t = std::min(n/a[k], tEnd);
+			magnitude += std::abs(c[n*K+k]) * std::pow(t, (double)n) * std::exp(-a[k]*t);
+		}
+		if (magnitude*epsilon > tolerance)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+CandidateBatch OptimizationProblem::makeBatch(const std::vector<DlibVector> &candidates)
+{
+	CandidateBatch batch;
+	batch.size = candidates.size();
+	const unsigned numTargets = candidates.empty() ? 0 : candidates[0].size()/3;
+	batch.onset.resize(batch.size);
+	batch.slope.resize(numTargets*batch.size);
+	batch.offset.resize(numTargets*batch.size);
+	batch.tau.resize(numTargets*batch.size);
+
+	for (unsigned k=0; k<batch.size; ++k)
+	{
+		if (candidates[k].size() != 3*numTargets+1)
+		{
+			throw dlib::error("[makeBatch] Candidates differ in size!");
+		}
+		batch.onset[k] = candidates[k](0);
+		for (unsigned i=0; i<numTargets; ++i)
+		{
+			batch.slope[i*batch.size+k] = candidates[k](3*i+1);
+			batch.offset[i*batch.size+k] = candidates[k](3*i+2);
+			batch.tau[i*batch.size+k] = candidates[k](3*i+3);
+		}
+	}
+
+	return batch;
+}
+
+// thrown by BudgetedObjective to abort a running solve
+struct OptimizationStopped {};
+
+// wraps an objective, keeps the best evaluated point and stops at a deadline or on request
+template <typename Objective>
+class BudgetedObjective {
+public:
+	BudgetedObjective (const Objective &op, const dlib::uint64 deadline, OptimizationObserver *observer)
+		: m_op(op), m_deadline(deadline), m_observer(observer), m_fbest(-1.0), m_evaluations(0) {};
+
+	double operator() (const DlibVector& arg) const
+	{
+		if (m_fbest >= 0.0 && stop())
+		{
+			throw OptimizationStopped();
+		}
+
+		double f = m_op(arg);
+		m_evaluations++;
+		if (m_fbest < 0.0 || f < m_fbest)
+		{
+			m_fbest = f;
+			m_xbest = arg;
+		}
+		return f;
+	}
+
+	// deadline exceeded or stop requested by observer
+	bool stop () const
+	{
+		return (m_deadline > 0 && m_ts.get_timestamp() > m_deadline) || (m_observer != 0 && m_observer->stopRequested());
+	}
+
+	// best point evaluated since last reset
+	void reset () { m_fbest = -1.0; m_evaluations = 0; }
+	double bestCost () const { return m_fbest; }
+	const DlibVector& bestPoint () const { return m_xbest; }
+	unsigned long evaluations () const { return m_evaluations; }
+
+private:
+	const Objective &m_op;
+	dlib::uint64 m_deadline; // [us] timestamp, 0 for no deadline
+	OptimizationObserver *m_observer;
+	dlib::timestamper m_ts;
+	mutable double m_fbest;
+	mutable DlibVector m_xbest;
+	mutable unsigned long m_evaluations;
+};
+
+// runs the random restarts of a global search, restarts may be called from several threads
+class RestartRunner : public RestartSource {
+public:
+	RestartRunner (const BobyqaOptimizer &optimizer, const OptimizationProblem &op, const std::vector<DlibVector> &starts, const DlibVector &lowerBound, const DlibVector &upperBound, const double rhoBegin, const double rhoEnd, const dlib::uint64 deadline)
+		: m_optimizer(optimizer), m_op(op), m_starts(starts), m_lowerBound(lowerBound), m_upperBound(upperBound), m_rhoBegin(rhoBegin), m_rhoEnd(rhoEnd), m_deadline(deadline),
+		  m_idle(m_mutex), m_cost(starts.size(), 0.0), m_x(starts.size()), m_fmin(1e6), m_completed(0), m_evaluations(0), m_truncated(false), m_next(0), m_active(0),
+		  m_owner(dlib::get_thread_id()), m_helperCpu(0.0)
+	{
+		m_start = m_ts.get_timestamp();
+	}
+
+	void run (long it)
+	{
+		BudgetedObjective<OptimizationProblem> objective (m_op, m_deadline, m_optimizer.m_observer);
+
+		// stop launching restarts when budget is spent
+		if (it > 0 && objective.stop())
+		{
+			dlib::auto_mutex lock(m_mutex);
+			m_truncated = true;
+			return;
+		}
+
+		// optmization setup
+		long npt (2*m_lowerBound.size()+1);	// number of interpolation points
+		const long max_f_evals (1e6); // max number of objective function evaluations
+
+		Profiler *profiler = m_optimizer.m_profiler;
+		RestartRecord record = {(unsigned)it, 0, "", 0, 0.0, 0.0, 0.0, 0.0, "converged"};
+		if (profiler != 0)
+		{
+			record.begin = profiler->elapsed();
+			record.cpu = Profiler::cpuTime();
+		}
+
+		DlibVector x = m_starts[it];
+		double ftmp (0.0);
+		bool completed (false), truncated (false);
+		const double cpuBegin = Profiler::cpuTime();
+		try
+		{
+			// optimization algorithm: BOBYQA
+			ftmp = dlib::find_min_bobyqa(objective,x,npt,m_lowerBound,m_upperBound,m_rhoBegin,m_rhoEnd,max_f_evals);
+			completed = true;
+		}
+		catch (OptimizationStopped&)
+		{
+			// running solve aborted, continue with best point evaluated so far
+			ftmp = objective.bestCost();
+			x = objective.bestPoint();
+			truncated = true;
+			record.status = "stopped";
+		}
+		catch (dlib::bobyqa_failure& err)
+		{
+			record.status = std::string("failure: ") + err.info;
+
+			// DEBUG message
+			#ifdef DEBUG_MSG
+			std::cout << "\t[optimize] WARNING: no convergence during optimization in iteration: " << it << std::endl << err.info << std::endl;
+			#endif
+		}
+
+		if (profiler != 0)
+		{
+			record.evaluations = objective.evaluations();
+			record.cost = ftmp;
+			record.wall = profiler->elapsed() - record.begin;
+			record.cpu = Profiler::cpuTime() - record.cpu;
+			profiler->addRestart(record);
+		}
+
+		// write optimization results back
+		dlib::auto_mutex lock(m_mutex);
+		m_cost[it] = ftmp;
+		m_x[it] = x;
+		m_completed += completed ? 1 : 0;
+		m_truncated = m_truncated || truncated;
+		m_evaluations += objective.evaluations();
+		if (dlib::get_thread_id() != m_owner)
+		{
+			m_helperCpu += Profiler::cpuTime() - cpuBegin;
+		}
+
+		OptimizationObserver *observer = m_optimizer.m_observer;
+		if (ftmp < m_fmin && ftmp > 0.0)	// opt returns 0 by error
+		{
+			m_fmin = ftmp;
+
+			// stream improved incumbent
+			if (observer != 0)
+			{
+				observer->onIncumbent(m_fmin, x(0), BobyqaOptimizer::dlibVec2targets(x, m_op.getPitchTargets()), elapsed());
+			}
+		}
+
+		if (observer != 0)
+		{
+			observer->onRestart(m_completed, m_starts.size(), m_fmin, elapsed());
+		}
+	}
+
+	bool claim (unsigned &it)
+	{
+		dlib::auto_mutex lock(m_mutex);
+		if (m_truncated || m_next >= m_starts.size())
+		{
+			return false;
+		}
+		it = m_next++;
+		m_active++;
+		return true;
+	}
+
+	void release ()
+	{
+		dlib::auto_mutex lock(m_mutex);
+		m_active--;
+		if (m_active == 0)
+		{
+			m_idle.broadcast();
+		}
+	}
+
+	unsigned unclaimed () const
+	{
+		dlib::auto_mutex lock(m_mutex);
+		return m_truncated ? 0 : m_starts.size() - m_next;
+	}
+
+	// waits for claimed restarts running in other threads
+	void wait ()
+	{
+		dlib::auto_mutex lock(m_mutex);
+		while (m_active > 0)
+		{
+			m_idle.wait();
+		}
+	}
+
+	// best result in restart order, independent of thread scheduling
+	bool best (double &fmin, DlibVector &xmin) const
+	{
+		fmin = 1e6;
+		for (unsigned it=0; it<m_cost.size(); ++it)
+		{
+			if (m_cost[it] < fmin && m_cost[it] > 0.0)
+			{
+				fmin = m_cost[it];
+				xmin = m_x[it];
+			}
+		}
+		return fmin < 1e6;
+	}
+
+	// restarts with a result, lowest cost first
+	std::vector<unsigned> ranking () const
+	{
+		std::vector<std::pair<double,unsigned> > order;
+		for (unsigned it=0; it<m_cost.size(); ++it)
+		{
+			if (m_cost[it] > 0.0)
+			{
+				order.push_back(std::make_pair(m_cost[it], it));
+			}
+		}
+		std::sort(order.begin(), order.end());
+
+		std::vector<unsigned> indices;
+		for (unsigned r=0; r<order.size(); ++r)
+		{
+			indices.push_back(order[r].second);
+		}
+		return indices;
+	}
+
+	const DlibVector& point (const unsigned it) const { return m_x[it]; }
+	unsigned completed () const { return m_completed; }
+	unsigned long evaluations () const { return m_evaluations; }
+	bool truncated () const { return m_truncated; }
+	double helperCpu () const { return m_helperCpu; }
+
+private:
+	double elapsed () const { return (m_ts.get_timestamp()-m_start)/1e6; }
+
+	const BobyqaOptimizer &m_optimizer;
+	const OptimizationProblem &m_op;
+	const std::vector<DlibVector> &m_starts;
+	const DlibVector &m_lowerBound;
+	const DlibVector &m_upperBound;
+	double m_rhoBegin;
+	double m_rhoEnd; // stopping trust region radius -> accuracy
+	dlib::uint64 m_deadline; // [us] timestamp, 0 for no deadline
+	dlib::timestamper m_ts;
+	dlib::uint64 m_start;
+	mutable dlib::mutex m_mutex;
+	dlib::signaler m_idle;
+	std::vector<double> m_cost;
+	std::vector<DlibVector> m_x;
+	double m_fmin;
+	unsigned m_completed;
+	unsigned long m_evaluations;
+	bool m_truncated;
+	unsigned m_next; // next restart to claim
+	unsigned m_active; // claimed restarts not yet released
+	dlib::thread_id_type m_owner; // thread of the optimization
+	double m_helperCpu; // [s] of restarts run by other threads
+};
+
+void BobyqaOptimizer::setTimeBudget(const double seconds)
+{
+	m_timeBudget = seconds;
+}
+
+void BobyqaOptimizer::setThreads(const unsigned threads)
+{
+	m_threads = std::max(threads, 1u);
+}
+
+void BobyqaOptimizer::setSeed(const unsigned long seed)
+{
+	m_random.set_seed(dlib::cast_to_string(seed));
+}
+
+void BobyqaOptimizer::setRestarts(const unsigned restarts)
+{
+	m_restarts = restarts;
+}
+
+void BobyqaOptimizer::setInitialSolutions(const std::vector<ModelSolution> &solutions)
+{
+	m_initialSolutions = solutions;
+}
+
+void BobyqaOptimizer::setPrecision(const Precision precision)
+{
+	m_precision = precision;
+}
+
+void BobyqaOptimizer::setObserver(OptimizationObserver *observer)
+{
+	m_observer = observer;
+}
+
+void BobyqaOptimizer::setProfiler(Profiler *profiler)
+{
+	m_profiler = profiler;
+}
+
+void BobyqaOptimizer::setPool(RestartPool *pool)
+{
+	m_pool = pool;
+}
+
+OptimizationReport BobyqaOptimizer::optimize(OptimizationProblem& op, const unsigned randIters) const
+{
+	int numTar = op.getPitchTargets().size();
+	ParameterSet ps = op.getParameters();
+
+	// precalculate bounds
+	double mmin = ps.meanSlope-ps.deltaSlope;
+	double bmin = ps.meanOffset-ps.deltaOffset;
+	double tmin = ps.meanTau-ps.deltaTau;
+	double mmax = ps.meanSlope+ps.deltaSlope;
+	double bmax = ps.meanOffset+ps.deltaOffset;
+	double tmax = ps.meanTau+ps.deltaTau;
+
+	DlibVector lowerBound, upperBound;
+	searchSpace(ps, numTar, lowerBound, upperBound);
+	const double rho_begin ((std::min(std::min(mmax-mmin, bmax-bmin),tmax-tmin)-1.0)/2.0); // initial trust region radius
+
+	// time budget
+	dlib::timestamper ts;
+	const dlib::uint64 deadline = (m_timeBudget > 0.0) ? ts.get_timestamp() + (dlib::uint64)(m_timeBudget*1e6) : 0;
+
+	// random initializations, drawn up front so results do not depend on the number of threads
+	unsigned itNum = (m_restarts > 0) ? m_restarts : randIters+numTar*5;
+	std::vector<DlibVector> starts (itNum);
+	for (unsigned it=0; it<itNum; ++it)
+	{
+		DlibVector &x = starts[it];
+		x.set_size(numTar*3 + 1);
+		x(0) = getRandomValue(ps.meanOffset-ps.deltaOffset, ps.meanOffset+ps.deltaOffset);
 		for (unsigned i=0; i<numTar; ++i)
 		{
 			x(3*i+1) = getRandomValue(mmin, mmax);
 			x(3*i+2) = getRandomValue(bmin, bmax);
 			x(3*i+3) = getRandomValue(tmin, tmax);
 		}
+	}
+
+	// known solutions come first, clamped to the search space
+	for (unsigned j=0, it=0; j<m_initialSolutions.size() && it<itNum; ++j)
+	{
+		const ModelSolution &sol = m_initialSolutions[j];
+		if (sol.targets.size() != numTar)
+			continue;
+
+		DlibVector &x = starts[it++];
+		x(0) = sol.onset;
+		for (unsigned i=0; i<numTar; ++i)
+		{
+			x(3*i+1) = sol.targets[i].slope;
+			x(3*i+2) = sol.targets[i].offset;
+			x(3*i+3) = sol.targets[i].tau;
+		}
+		x = dlib::clamp(x, lowerBound, upperBound);
+	}
+
+	// restarts in single precision run on a copy, so the problem keeps its precision for the result
+	OptimizationProblem coarse (op);
+	if (m_precision != DOUBLE_PRECISION)
+	{
+		coarse.setPrecision(SINGLE_PRECISION);
+	}
+	const double rho_end = (m_precision == DOUBLE_PRECISION) ? 1e-6 : 1e-4; // float cost cannot resolve smaller steps
+
+	RestartRunner runner (*this, coarse, starts, lowerBound, upperBound, rho_begin, rho_end, deadline);
+	if (m_pool != 0)
+	{
+		// restarts are claimed one at a time, so idle threads of the pool can take some of them
+		m_pool->add(&runner);
+		unsigned it (0);
+		while (runner.claim(it))
+		{
+			runner.run(it);
+			runner.release();
+		}
+		m_pool->remove(&runner);
+		runner.wait();
+	}
+	else if (m_threads > 1)
+	{
+		dlib::parallel_for(m_threads, 0, itNum, runner, &RestartRunner::run, 1);
+	}
+	else
+	{
+		for (unsigned it=0; it<itNum && !runner.truncated(); ++it)
+		{
+			runner.run(it);
+		}
+	}
+
+	double fmin;
+	DlibVector xtmp;
+	if (!runner.best(fmin, xtmp))
+	{
+		throw dlib::error("[optimize] BOBYQA algorithms didn't converge! Try to increase number of evaluations");
+	}
+
+	// store optimum
+	{
+		Profiler::Scope scope (m_profiler, "metrics");
+		op.setOptimum(xtmp(0), dlibVec2targets(xtmp, op.getPitchTargets()));
+	}
+	OptimizationReport report = {fmin, runner.completed(), runner.truncated(), runner.evaluations(), runner.helperCpu()};
+
+	// refine the best coarse candidates in double precision
+	if (m_precision == MIXED_PRECISION && !report.truncated)
+	{
+		Profiler::Scope scope (m_profiler, "polish");
+		const unsigned candidates (3);
+		std::vector<unsigned> ranking = runner.ranking();
+		report.cost = 1e6;
+		for (unsigned r=0; r<ranking.size() && r<candidates; ++r)
+		{
+			const DlibVector &x = runner.point(ranking[r]);
+			OptimizationProblem fine (op);
+			fine.setOptimum(x(0), dlibVec2targets(x, op.getPitchTargets()));
+			OptimizationReport polished = polish(fine);
+			report.evaluations += polished.evaluations;
+			if (polished.cost < report.cost)
+			{
+				report.cost = polished.cost;
+				op = fine;
+			}
+		}
+	}
+
+	// DEBUG message
+	#ifdef DEBUG_MSG
+	std::cout << "\t[optimize] mse = " << fmin << std::endl;
+	#endif
+
+	return report;
+}
+
+// optimizes a subset of targets, all other parameters are kept at the current optimum
+class SubsetObjective {
+public:
+	SubsetObjective (const OptimizationProblem &op, const DlibVector &x, const std::vector<unsigned> &freeTargets)
+		: m_op(op), m_x(x), m_free(freeTargets), m_evaluations(0) {};
+
+	double operator() (const DlibVector& arg) const
+	{
+		m_evaluations++;
+		return m_op(expand(arg));
+	}
+
+	unsigned long evaluations () const { return m_evaluations; }
+
+	// full parameter vector from subset parameters
+	DlibVector expand (const DlibVector& arg) const
+	{
+		DlibVector x (m_x);
+		for (unsigned j=0; j<m_free.size(); ++j)
+		{
+			x(3*m_free[j]+1) = arg(3*j);
+			x(3*m_free[j]+2) = arg(3*j+1);
+			x(3*m_free[j]+3) = arg(3*j+2);
+		}
+		return x;
+	}
+
+private:
+	const OptimizationProblem &m_op;
+	DlibVector m_x;
+	std::vector<unsigned> m_free;
+	mutable unsigned long m_evaluations;
+};
+
+OptimizationReport BobyqaOptimizer::optimizeLocal(OptimizationProblem& op, const std::vector<unsigned> &freeTargets, const unsigned randIters) const
+{
+	TargetVector targets = op.getPitchTargets();
+	ParameterSet ps = op.getParameters();
+	OptimizationReport report = {0.0, 0, false, 0, 0.0};
+
+	// current optimum as full parameter vector
+	DlibVector x;
+	x.set_size(targets.size()*3 + 1);
+	x(0) = op.getOnset().value;
+	for (unsigned i=0; i<targets.size(); ++i)
+	{
+		x(3*i+1) = targets[i].slope;
+		x(3*i+2) = targets[i].offset;
+		x(3*i+3) = targets[i].tau;
+	}
+
+	if (freeTargets.empty())
+	{
+		report.cost = op(x);
+		return report;
+	}
+
+	// search space of the free targets
+	DlibVector lowerBound, upperBound;
+	lowerBound.set_size(freeTargets.size()*3);
+	upperBound.set_size(freeTargets.size()*3);
+	for (unsigned j=0; j<freeTargets.size(); ++j)
+	{
+		lowerBound(3*j) = ps.meanSlope-ps.deltaSlope;
+		lowerBound(3*j+1) = ps.meanOffset-ps.deltaOffset;
+		lowerBound(3*j+2) = ps.meanTau-ps.deltaTau;
+		upperBound(3*j) = ps.meanSlope+ps.deltaSlope;
+		upperBound(3*j+1) = ps.meanOffset+ps.deltaOffset;
+		upperBound(3*j+2) = ps.meanTau+ps.deltaTau;
+	}
+
+	// optmization setup (see optimize)
+	long npt (2*lowerBound.size()+1);
+	const double rho_begin ((std::min(std::min(2*ps.deltaSlope, 2*ps.deltaOffset),2*ps.deltaTau)-1.0)/2.0);
+	const double rho_end (1e-6);
+	const long max_f_evals (1e6);
+	SubsetObjective objective (op, x, freeTargets);
+
+	// time budget and stop requests also abort a running solve
+	dlib::timestamper ts;
+	const dlib::uint64 deadline = (m_timeBudget > 0.0) ? ts.get_timestamp() + (dlib::uint64)(m_timeBudget*1e6) : 0;
+	BudgetedObjective<SubsetObjective> budgeted (objective, deadline, m_observer);
+
+	// warm start at current values (clamped to search space), then random restarts
+	DlibVector xopt;
+	double fmin (-1.0);
+	for (unsigned it=0; it<randIters+1; ++it)
+	{
+		// stop on request, keeping the best result so far
+		if (it > 0 && budgeted.stop())
+		{
+			report.truncated = true;
+			break;
+		}
+
+		DlibVector xs;
+		xs.set_size(lowerBound.size());
+		for (unsigned j=0; j<freeTargets.size(); ++j)
+		{
+			xs(3*j) = x(3*freeTargets[j]+1);
+			xs(3*j+1) = x(3*freeTargets[j]+2);
+			xs(3*j+2) = x(3*freeTargets[j]+3);
+		}
+		for (long j=0; j<xs.size(); ++j)
+		{
+			xs(j) = (it == 0) ? std::min(std::max(xs(j), lowerBound(j)), upperBound(j)) : getRandomValue(lowerBound(j), upperBound(j));
+		}
 
+		budgeted.reset();
 		try
 		{
-			// optimization algorithm: BOBYQA
-			ftmp = dlib::find_min_bobyqa(op,x,npt,lowerBound,upperBound,rho_begin,rho_end,max_f_evals);
+			double ftmp = dlib::find_min_bobyqa(budgeted,xs,npt,lowerBound,upperBound,rho_begin,rho_end,max_f_evals);
+			report.restarts++;
+			if (fmin < 0.0 || ftmp < fmin)
+			{
+				fmin = ftmp;
+				xopt = xs;
+			}
+		}
+		catch (OptimizationStopped&)
+		{
+			// running solve aborted, continue with best point evaluated so far
+			report.truncated = true;
+			if (fmin < 0.0 || budgeted.bestCost() < fmin)
+			{
+				fmin = budgeted.bestCost();
+				xopt = budgeted.bestPoint();
+			}
+			break;
 		}
 		catch (dlib::bobyqa_failure& err)
 		{
 			// DEBUG message
 			#ifdef DEBUG_MSG
-			std::cout << "\t[optimize] WARNING: no convergence during optimization in iteration: " << it << std::endl << err.info << std::endl;
+			std::cout << "\t[optimizeLocal] WARNING: no convergence during optimization in iteration: " << it << std::endl << err.info << std::endl;
 			#endif
 		}
+	}
 
-		// write optimization results back
-		dlib::auto_mutex lock(mu);
-		if (ftmp < fmin && ftmp > 0.0)	// opt returns 0 by error
+	if (fmin < 0.0)
+	{
+		throw dlib::error("[optimizeLocal] BOBYQA algorithms didn't converge!");
+	}
+
+	// store optimum
+	DlibVector xfull = objective.expand(xopt);
+	op.setOptimum(xfull(0), dlibVec2targets(xfull, targets));
+	report.cost = fmin;
+	report.evaluations = objective.evaluations();
+
+	return report;
+}
+
+OptimizationReport BobyqaOptimizer::reoptimize(OptimizationProblem& op, const double onsetVal, const TargetVector &previous, const std::vector<unsigned> &changedBounds, const unsigned neighbourhood, const bool polish) const
+{
+	// previous targets with durations of the new bounds as warm start
+	TargetVector targets = op.getPitchTargets();
+	if (previous.size() != targets.size())
+	{
+		throw dlib::error("[reoptimize] Number of syllables has changed, a full optimization is required!");
+	}
+	for (unsigned i=0; i<targets.size(); ++i)
+	{
+		targets[i].slope = previous[i].slope;
+		targets[i].offset = previous[i].offset;
+		targets[i].tau = previous[i].tau;
+	}
+	op.setOptimum(onsetVal, targets);
+
+	// a bound affects the syllables on both sides, neighbourhood extends this range
+	std::set<unsigned> freeTargets;
+	for (unsigned j=0; j<changedBounds.size(); ++j)
+	{
+		unsigned b = changedBounds[j];
+		unsigned first = (b > neighbourhood) ? b-neighbourhood : 0;
+		unsigned last = std::min<unsigned>(b+neighbourhood, targets.size());
+		for (unsigned i=first; i<last; ++i)
 		{
-			fmin = ftmp;
-			xtmp = x;
+			freeTargets.insert(i);
 		}
 	}
 
-	if (fmin == 1e6)
+	OptimizationReport report = optimizeLocal(op, std::vector<unsigned>(freeTargets.begin(), freeTargets.end()));
+	if (polish && !report.truncated)
 	{
-		throw dlib::error("[optimize] BOBYQA algorithms didn't converge! Try to increase number of evaluations");
+		OptimizationReport pr = this->polish(op);
+		report.cost = pr.cost;
+		report.restarts += pr.restarts;
+		report.evaluations += pr.evaluations;
+	}
+
+	return report;
+}
+
+OptimizationReport BobyqaOptimizer::polish(OptimizationProblem& op) const
+{
+	TargetVector targets = op.getPitchTargets();
+	ParameterSet ps = op.getParameters();
+	OptimizationReport report = {0.0, 0, false, 0, 0.0};
+
+	DlibVector lowerBound, upperBound;
+	searchSpace(ps, targets.size(), lowerBound, upperBound);
+
+	// start at current optimum (clamped to search space)
+	DlibVector x;
+	x.set_size(lowerBound.size());
+	x(0) = op.getOnset().value;
+	for (unsigned i=0; i<targets.size(); ++i)
+	{
+		x(3*i+1) = targets[i].slope;
+		x(3*i+2) = targets[i].offset;
+		x(3*i+3) = targets[i].tau;
+	}
+	x = dlib::clamp(x, lowerBound, upperBound);
+
+	// joint refinement with a small initial trust region
+	long npt (2*lowerBound.size()+1);
+	const double rho_begin (std::min(1.0, (std::min(std::min(2*ps.deltaSlope, 2*ps.deltaOffset),2*ps.deltaTau)-1.0)/2.0));
+	const double rho_end (1e-6);
+	const long max_f_evals (1e6);
+
+	BudgetedObjective<OptimizationProblem> objective (op, 0, 0);
+	try
+	{
+		report.cost = dlib::find_min_bobyqa(objective,x,npt,lowerBound,upperBound,rho_begin,rho_end,max_f_evals);
+		report.restarts = 1;
+		op.setOptimum(x(0), dlibVec2targets(x, targets));
+	}
+	catch (dlib::bobyqa_failure& err)
+	{
+		// keep current optimum
+		report.cost = op(x);
+
+		// DEBUG message
+		#ifdef DEBUG_MSG
+		std::cout << "\t[polish] WARNING: no convergence during optimization" << std::endl << err.info << std::endl;
+		#endif
+	}
+	report.evaluations = objective.evaluations();
+
+	return report;
+}
+
+std::vector<unsigned> BobyqaOptimizer::findChangedBounds (const BoundVector &previous, const BoundVector &current, const double tolerance)
+{
+	if (previous.size() != current.size())
+	{
+		throw dlib::error("[findChangedBounds] Number of syllable bounds has changed!");
 	}
 
-	// convert result to TargetVector
-	TargetVector opt;
+	std::vector<unsigned> changed;
+	for (unsigned i=0; i<current.size(); ++i)
+	{
+		if (std::abs(previous[i] - current[i]) > tolerance)
+		{
+			changed.push_back(i);
+		}
+	}
+
+	return changed;
+}
+
+void BobyqaOptimizer::searchSpace (const ParameterSet &ps, const unsigned numTar, DlibVector &lowerBound, DlibVector &upperBound)
+{
+	lowerBound.set_size(numTar*3 + 1);
+	upperBound.set_size(numTar*3 + 1);
+	lowerBound(0) = ps.meanOffset-ps.deltaOffset;
+	upperBound(0) = ps.meanOffset+ps.deltaOffset;
+
 	for (unsigned i=0; i<numTar; ++i)
 	{
-		PitchTarget pt;
-		pt.slope = xtmp(3*i+1);
-		pt.offset = xtmp(3*i+2);
-		pt.tau = xtmp(3*i+3);
-		pt.duration = op.getPitchTargets()[i].duration;
-		opt.push_back(pt);
+		lowerBound(3*i+1) = ps.meanSlope-ps.deltaSlope;
+		lowerBound(3*i+2) = ps.meanOffset-ps.deltaOffset;
+		lowerBound(3*i+3) = ps.meanTau-ps.deltaTau;
+		upperBound(3*i+1) = ps.meanSlope+ps.deltaSlope;
+		upperBound(3*i+2) = ps.meanOffset+ps.deltaOffset;
+		upperBound(3*i+3) = ps.meanTau+ps.deltaTau;
 	}
+}
 
-	// store optimum
-	op.setOptimum(xtmp(0), opt);
+TargetVector BobyqaOptimizer::dlibVec2targets (const DlibVector &x, const TargetVector &durations)
+{
+	TargetVector targets;
+	for (unsigned i=0; i<durations.size(); ++i)
+	{
+		PitchTarget pt;
+		pt.slope = x(3*i+1);
+		pt.offset = x(3*i+2);
+		pt.tau = x(3*i+3);
+		pt.duration = durations[i].duration;
+		targets.push_back(pt);
+	}
 
-	// DEBUG message
-	#ifdef DEBUG_MSG
-	std::cout << "\t[optimize] mse = " << fmin << std::endl;
-	#endif
+	return targets;
 }
 
-double BobyqaOptimizer::getRandomValue (const double min, const double max)
+double BobyqaOptimizer::getRandomValue (const double min, const double max) const
 {
-	return min + ((double)rand()/RAND_MAX)*(max-min);
+	return min + m_random.get_random_double()*(max-min);
 }
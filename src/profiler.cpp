@@ -0,0 +1,215 @@
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#ifndef _WIN32
+#include <time.h>
+#include <sys/resource.h>
+#endif
+#include "profiler.h"
+#include "dataio.h"
+
+Profiler::Scope::Scope (Profiler *profiler, const std::string &name)
+	: m_profiler(profiler), m_name(name), m_begin(0.0), m_cpuBegin(0.0)
+{
+	if (m_profiler != 0)
+	{
+		m_begin = m_profiler->elapsed();
+		m_cpuBegin = cpuTime();
+	}
+}
+
+Profiler::Scope::~Scope ()
+{
+	close();
+}
+
+void Profiler::Scope::close()
+{
+	if (m_profiler != 0)
+	{
+		m_profiler->addPhase(m_name, m_begin, m_profiler->elapsed()-m_begin, cpuTime()-m_cpuBegin);
+		m_profiler = 0;
+	}
+}
+
+Profiler::Profiler ()
+	: m_batch(0)
+{
+	m_start = m_ts.get_timestamp();
+}
+
+Profiler::Profiler (Profiler &batch, const std::string &job)
+	: m_batch(&batch), m_job(job)
+{
+	m_start = m_ts.get_timestamp();
+}
+
+void Profiler::addPhase(const std::string &name, const double begin, const double wall, const double cpu)
+{
+	addPhase(name, m_job, begin, wall, cpu);
+}
+
+void Profiler::addRestart(const RestartRecord &record)
+{
+	addRestart(record, m_job);
+}
+
+void Profiler::setLabel(const std::string &label)
+{
+	m_label = label;
+}
+
+double Profiler::elapsed() const
+{
+	// job profilers share the clock of the batch
+	if (m_batch != 0)
+	{
+		return m_batch->elapsed();
+	}
+	return (m_ts.get_timestamp()-m_start)/1e6;
+}
+
+unsigned long Profiler::evaluations() const
+{
+	dlib::auto_mutex lock(m_mutex);
+	unsigned long n (0);
+	for (unsigned i=0; i<m_restarts.size(); ++i)
+	{
+		n += m_restarts[i].evaluations;
+	}
+	return n;
+}
+
+void Profiler::writeReport(const std::string &jsonFile) const
+{
+	std::ofstream fout (jsonFile.c_str());
+	if (!fout.good())
+	{
+		throw dlib::error("[writeReport] Report file cannot be created!");
+	}
+
+	const unsigned long totalEvaluations = evaluations();
+	dlib::auto_mutex lock(m_mutex);
+	fout << "{\n  \"label\": \"" << jsonEscape(m_label) << "\",\n";
+	fout << "  \"wall\": " << jsonNumber(elapsed()) << ",\n";
+	fout << "  \"cpu\": " << jsonNumber((double)std::clock()/CLOCKS_PER_SEC) << ",\n"; // all threads
+	fout << "  \"evaluations\": " << totalEvaluations << ",\n";
+	fout << "  \"threads\": " << m_threads.size() << ",\n";
+	fout << "  \"peak_memory_kb\": " << peakMemory() << ",\n";
+
+	// phases in order of completion
+	fout << "  \"phases\": [";
+	bool first (true);
+	for (unsigned i=0; i<m_events.size(); ++i)
+	{
+		if (m_events[i].category != "phase")
+			continue;
+		fout << (first ? "\n" : ",\n") << "    {\"name\": \"" << jsonEscape(m_events[i].name) << "\", \"job\": \"" << jsonEscape(m_events[i].job) << "\", \"begin\": " << jsonNumber(m_events[i].begin)
+			 << ", \"wall\": " << jsonNumber(m_events[i].wall) << ", \"cpu\": " << jsonNumber(m_events[i].cpu) << "}";
+		first = false;
+	}
+	fout << "\n  ],\n";
+
+	fout << "  \"restarts\": [";
+	for (unsigned i=0; i<m_restarts.size(); ++i)
+	{
+		const RestartRecord &r = m_restarts[i];
+		fout << (i == 0 ? "\n" : ",\n") << "    {\"index\": " << r.index << ", \"job\": \"" << jsonEscape(r.job) << "\", \"thread\": " << r.thread << ", \"evaluations\": " << r.evaluations
+			 << ", \"cost\": " << jsonNumber(r.cost) << ", \"begin\": " << jsonNumber(r.begin) << ", \"wall\": " << jsonNumber(r.wall) << ", \"cpu\": " << jsonNumber(r.cpu)
+			 << ", \"status\": \"" << jsonEscape(r.status) << "\"}";
+	}
+	fout << "\n  ]\n}\n";
+}
+
+void Profiler::writeTrace(const std::string &traceFile) const
+{
+	std::ofstream fout (traceFile.c_str());
+	if (!fout.good())
+	{
+		throw dlib::error("[writeTrace] Trace file cannot be created!");
+	}
+
+	// complete events, timestamps in us
+	dlib::auto_mutex lock(m_mutex);
+	fout << std::fixed;
+	fout << "{\"traceEvents\": [";
+	for (unsigned i=0; i<m_events.size(); ++i)
+	{
+		const Event &e = m_events[i];
+		fout << (i == 0 ? "\n" : ",\n") << "  {\"name\": \"" << jsonEscape(e.name) << "\", \"cat\": \"" << e.category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.thread
+			 << ", \"ts\": " << (long long)(e.begin*1e6) << ", \"dur\": " << (long long)(e.wall*1e6) << ", \"tdur\": " << (long long)(e.cpu*1e6)
+			 << ", \"args\": " << e.args << "}";
+	}
+	fout << "\n],\n\"displayTimeUnit\": \"ms\",\n\"otherData\": {\"label\": \"" << jsonEscape(m_label) << "\"}}\n";
+}
+
+double Profiler::cpuTime()
+{
+#ifndef _WIN32
+	timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+	{
+		return ts.tv_sec + ts.tv_nsec/1e9;
+	}
+#endif
+	return (double)std::clock()/CLOCKS_PER_SEC;
+}
+
+long Profiler::peakMemory()
+{
+#ifndef _WIN32
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		return usage.ru_maxrss;
+	}
+#endif
+	return 0;
+}
+
+void Profiler::addPhase(const std::string &name, const std::string &job, const double begin, const double wall, const double cpu)
+{
+	if (m_batch != 0)
+	{
+		m_batch->addPhase(name, job, begin, wall, cpu);
+		return;
+	}
+
+	dlib::auto_mutex lock(m_mutex);
+	Event e = {name, "phase", job, threadIndex(), begin, wall, cpu, "{\"job\": \"" + jsonEscape(job) + "\"}"};
+	m_events.push_back(e);
+}
+
+void Profiler::addRestart(const RestartRecord &record, const std::string &job)
+{
+	if (m_batch != 0)
+	{
+		m_batch->addRestart(record, job);
+		return;
+	}
+
+	dlib::auto_mutex lock(m_mutex);
+	RestartRecord r = record;
+	r.thread = threadIndex();
+	r.job = job;
+	m_restarts.push_back(r);
+
+	std::ostringstream args;
+	args << "{\"job\": \"" << jsonEscape(r.job) << "\", \"evaluations\": " << r.evaluations << ", \"cost\": " << jsonNumber(r.cost) << ", \"status\": \"" << jsonEscape(r.status) << "\"}";
+	std::ostringstream name;
+	name << "restart " << r.index;
+	Event e = {name.str(), "restart", r.job, r.thread, r.begin, r.wall, r.cpu, args.str()};
+	m_events.push_back(e);
+}
+
+unsigned Profiler::threadIndex()
+{
+	// small consecutive ids instead of system thread ids, caller holds the mutex
+	dlib::thread_id_type id = dlib::get_thread_id();
+	std::map<dlib::thread_id_type, unsigned>::iterator it = m_threads.find(id);
+	if (it == m_threads.end())
+	{
+		it = m_threads.insert(std::make_pair(id, (unsigned)m_threads.size())).first;
+	}
+	return it->second;
+}
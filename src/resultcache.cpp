@@ -0,0 +1,171 @@
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <sys/stat.h>
+#include <utime.h>
+#include <dlib/dir_nav.h>
+#include <dlib/misc_api.h>
+#include <dlib/general_hash/murmur_hash3.h>
+#include "resultcache.h"
+
+// bump when the meaning of cached results changes
+static const char* CACHE_FORMAT = "TargetOptimizer result cache 1";
+
+ResultCache::ResultCache (const std::string &directory, const unsigned long long maxBytes)
+	: m_directory(directory), m_maxBytes(maxBytes)
+{
+	if (!m_directory.empty() && m_directory[m_directory.size()-1] != '/')
+	{
+		m_directory += "/";
+	}
+
+	struct stat st;
+	if (stat(m_directory.c_str(), &st) != 0)
+	{
+		dlib::create_directory(m_directory);
+	}
+	else if (!S_ISDIR(st.st_mode))
+	{
+		throw dlib::error("[ResultCache] Cache path is not a directory!");
+	}
+}
+
+bool ResultCache::lookup(const std::string &key, CachedResult &result) const
+{
+	const std::string file = entryFile(key);
+	std::ifstream fin (file.c_str());
+	if (!fin.good())
+	{
+		return false;
+	}
+
+	// header and key guard against foreign files and format changes
+	std::string format, storedKey;
+	if (!std::getline(fin, format) || format != CACHE_FORMAT || !std::getline(fin, storedKey) || storedKey != key)
+	{
+		return false;
+	}
+
+	CachedResult entry;
+	unsigned numTargets (0);
+	if (!(fin >> entry.cost >> entry.solution.onset >> numTargets))
+	{
+		return false;
+	}
+	for (unsigned i=0; i<numTargets; ++i)
+	{
+		PitchTarget pt;
+		if (!(fin >> pt.slope >> pt.offset >> pt.tau >> pt.duration))
+		{
+			return false;
+		}
+		entry.solution.targets.push_back(pt);
+	}
+	result = entry;
+
+	// modification time serves as last access time for eviction
+	utime(file.c_str(), 0);
+	return true;
+}
+
+void ResultCache::store(const std::string &key, const CachedResult &result)
+{
+	dlib::auto_mutex lock (m_mutex);
+
+	// write to a temporary file first, so concurrent readers never see a partial entry
+	const std::string file = entryFile(key);
+	const std::string tmpFile = file + ".tmp";
+	{
+		std::ofstream fout (tmpFile.c_str());
+		if (!fout.good())
+		{
+			throw dlib::error("[store] Cache entry cannot be written!");
+		}
+		fout.precision(17);
+		fout << CACHE_FORMAT << "\n" << key << "\n";
+		fout << result.cost << "\n" << result.solution.onset << "\n" << result.solution.targets.size() << "\n";
+		for (unsigned i=0; i<result.solution.targets.size(); ++i)
+		{
+			const PitchTarget &pt = result.solution.targets[i];
+			fout << pt.slope << " " << pt.offset << " " << pt.tau << " " << pt.duration << "\n";
+		}
+		if (!fout.good())
+		{
+			throw dlib::error("[store] Cache entry cannot be written!");
+		}
+	}
+
+	if (std::rename(tmpFile.c_str(), file.c_str()) != 0)
+	{
+		std::remove(tmpFile.c_str());
+		throw dlib::error("[store] Cache entry cannot be replaced!");
+	}
+
+	if (m_maxBytes > 0)
+	{
+		evict();
+	}
+}
+
+std::string ResultCache::makeKey(const BoundVector &bounds, const TimeSignal &f0, const ParameterSet &parameters, const std::string &settings)
+{
+	// hash exact binary values, any change of the inputs gives a new key
+	std::vector<double> data;
+	data.push_back(bounds.size());
+	data.insert(data.end(), bounds.begin(), bounds.end());
+	data.push_back(f0.size());
+	for (unsigned i=0; i<f0.size(); ++i)
+	{
+		data.push_back(f0[i].time);
+		data.push_back(f0[i].value);
+	}
+	const double ps[] = {parameters.deltaSlope, parameters.deltaOffset, parameters.deltaTau, parameters.lambda,
+		parameters.weightSlope, parameters.weightOffset, parameters.weightTau,
+		parameters.meanSlope, parameters.meanOffset, parameters.meanTau};
+	data.insert(data.end(), ps, ps + sizeof(ps)/sizeof(ps[0]));
+
+	std::string bytes ((const char*)&data[0], data.size()*sizeof(double));
+	bytes += settings;
+	bytes += CACHE_FORMAT;
+	std::pair<dlib::uint64,dlib::uint64> h = dlib::murmur_hash3_128bit(bytes.data(), bytes.size());
+
+	std::ostringstream key;
+	key << std::hex << std::setfill('0') << std::setw(16) << h.first << std::setw(16) << h.second;
+	return key.str();
+}
+
+std::string ResultCache::entryFile(const std::string &key) const
+{
+	return m_directory + key + ".result";
+}
+
+void ResultCache::evict()
+{
+	// oldest access first
+	std::vector<std::pair<time_t,std::string> > entries;
+	std::vector<dlib::file> files = dlib::directory(m_directory).get_files();
+	unsigned long long total (0);
+	for (unsigned i=0; i<files.size(); ++i)
+	{
+		struct stat st;
+		const std::string &name = files[i].name();
+		if (name.size() < 7 || name.compare(name.size()-7, 7, ".result") != 0 || stat(files[i].full_name().c_str(), &st) != 0)
+			continue;
+
+		entries.push_back(std::make_pair(st.st_mtime, files[i].full_name()));
+		total += st.st_size;
+	}
+	std::sort(entries.begin(), entries.end());
+
+	// another process may have removed an entry already, so failures are ignored
+	for (unsigned i=0; i<entries.size() && total > m_maxBytes; ++i)
+	{
+		struct stat st;
+		if (stat(entries[i].second.c_str(), &st) == 0 && std::remove(entries[i].second.c_str()) == 0)
+		{
+			total -= st.st_size;
+		}
+	}
+}
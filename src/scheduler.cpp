@@ -0,0 +1,167 @@
+#include <algorithm>
+#include "scheduler.h"
+
+RestartPool::RestartPool ()
+	: m_closed(false), m_available(m_mutex)
+{
+}
+
+void RestartPool::add(RestartSource *source)
+{
+	dlib::auto_mutex lock(m_mutex);
+	m_sources.push_back(source);
+	m_available.broadcast();
+}
+
+void RestartPool::remove(RestartSource *source)
+{
+	dlib::auto_mutex lock(m_mutex);
+	m_sources.erase(std::remove(m_sources.begin(), m_sources.end(), source), m_sources.end());
+}
+
+bool RestartPool::help()
+{
+	RestartSource *source (0);
+	unsigned it (0);
+	{
+		dlib::auto_mutex lock(m_mutex);
+		while (true)
+		{
+			// the optimization with most work left, it stays alive until the claimed restart is released
+			RestartSource *largest (0);
+			for (unsigned i=0; i<m_sources.size(); ++i)
+			{
+				if (m_sources[i]->unclaimed() > 0 && (largest == 0 || m_sources[i]->unclaimed() > largest->unclaimed()))
+				{
+					largest = m_sources[i];
+				}
+			}
+			if (largest != 0 && largest->claim(it))
+			{
+				source = largest;
+				break;
+			}
+			if (largest == 0 && m_closed)
+			{
+				return false;
+			}
+			if (largest == 0)
+			{
+				m_available.wait();
+			}
+		}
+	}
+
+	source->run(it);
+	source->release();
+	return true;
+}
+
+void RestartPool::close()
+{
+	dlib::auto_mutex lock(m_mutex);
+	m_closed = true;
+	m_available.broadcast();
+}
+
+// entry point of the worker threads
+class SchedulerWorker {
+public:
+	SchedulerWorker (BatchScheduler &scheduler) : m_scheduler(scheduler) {}
+	void run (long) { m_scheduler.work(); }
+
+private:
+	BatchScheduler &m_scheduler;
+};
+
+BatchScheduler::BatchScheduler (const unsigned threads)
+	: m_threads(std::max(threads, 1u)), m_jobs(0), m_next(0), m_running(0)
+{
+}
+
+RestartPool& BatchScheduler::pool()
+{
+	return m_pool;
+}
+
+void BatchScheduler::run(const std::vector<double> &costs, BatchJobs &jobs)
+{
+	m_order = largestFirst(costs);
+	m_jobs = &jobs;
+	m_next = 0;
+	m_running = 0;
+	if (m_order.empty())
+	{
+		return;
+	}
+
+	SchedulerWorker worker (*this);
+	if (m_threads > 1)
+	{
+		dlib::parallel_for(m_threads, 0, m_threads, worker, &SchedulerWorker::run, 1);
+	}
+	else
+	{
+		worker.run(0);
+	}
+}
+
+double BatchScheduler::estimateCost(const dlib::uint64 textGridSize, const dlib::uint64 pitchTierSize)
+{
+	// jobs are only ranked, so the counts are taken from the file sizes instead of parsing:
+	// an interval takes about 50 bytes of a TextGrid, a sample about 40 bytes of a PitchTier
+	const double syllables = textGridSize/50.0;
+	const double samples = pitchTierSize/40.0;
+
+	// restarts grow linearly with the syllables, evaluations per restart about quadratically
+	// with the number of parameters, each evaluation linearly with the samples
+	const double parameters = 3*syllables + 1;
+	return (10 + 5*syllables) * parameters * parameters * (samples + 1);
+}
+
+std::vector<unsigned> BatchScheduler::largestFirst(const std::vector<double> &costs)
+{
+	// ties keep the job list order
+	std::vector<std::pair<double,unsigned> > order;
+	for (unsigned j=0; j<costs.size(); ++j)
+	{
+		order.push_back(std::make_pair(-costs[j], j));
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<unsigned> indices;
+	for (unsigned j=0; j<order.size(); ++j)
+	{
+		indices.push_back(order[j].second);
+	}
+	return indices;
+}
+
+void BatchScheduler::work()
+{
+	// start jobs as long as there are any, then help the running ones
+	while (true)
+	{
+		unsigned job (0);
+		{
+			dlib::auto_mutex lock(m_mutex);
+			if (m_next >= m_order.size())
+				break;
+			job = m_order[m_next++];
+			m_running++;
+		}
+
+		m_jobs->runJob(job);
+
+		dlib::auto_mutex lock(m_mutex);
+		m_running--;
+		if (m_running == 0 && m_next >= m_order.size())
+		{
+			m_pool.close();
+		}
+	}
+
+	while (m_pool.help())
+	{
+	}
+}
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <math.h>
+#include <dlib/cmd_line_parser.h>
+#include <dlib/string.h>
+#include "model.h"
+#include "dataio.h"
+
+// squared errors of recovered targets against ground truth
+struct Score
+{
+	double slope;
+	double offset;
+	double tau;
+	double onset;
+	double f0; // model contours, sum over samples
+	unsigned targets;
+	unsigned samples;
+};
+
+static Score compare (const std::string &truthFile, const std::string &resultFile, const double samplingPeriod)
+{
+	CsvReader truth (truthFile);
+	CsvReader result (resultFile);
+	TargetVector tt = truth.getTargets();
+	TargetVector rt = result.getTargets();
+	if (tt.size() != rt.size())
+	{
+		throw dlib::error("[compare] Number of targets differs: " + resultFile);
+	}
+
+	Score s = {0.0, 0.0, 0.0, 0.0, 0.0, (unsigned)tt.size(), 0};
+	for (unsigned i=0; i<tt.size(); ++i)
+	{
+		if (std::fabs(tt[i].duration - rt[i].duration) > 1e-4)
+		{
+			throw dlib::error("[compare] Syllable bounds differ: " + resultFile);
+		}
+		s.slope += std::pow(tt[i].slope - rt[i].slope, 2.0);
+		s.offset += std::pow(tt[i].offset - rt[i].offset, 2.0);
+		s.tau += std::pow(tt[i].tau - rt[i].tau, 2.0);
+	}
+	s.onset = std::pow(truth.getOnset().value - result.getOnset().value, 2.0);
+
+	// targets are not always identifiable, so compare the resulting contours as well
+	TamModelF0 truthModel (truth.getBounds());
+	truthModel.setOnsetValue(truth.getOnset().value);
+	truthModel.setPitchTargets(tt);
+	TamModelF0 resultModel (truth.getBounds());
+	resultModel.setOnsetValue(result.getOnset().value);
+	resultModel.setPitchTargets(rt);
+	TimeSignal tf0 = truthModel.calculateF0(samplingPeriod);
+	TimeSignal rf0 = resultModel.calculateF0(samplingPeriod);
+	for (unsigned k=0; k<tf0.size() && k<rf0.size(); ++k)
+	{
+		s.f0 += std::pow(tf0[k].value - rf0[k].value, 2.0);
+		s.samples++;
+	}
+
+	return s;
+}
+
+static void printScore (const std::string &label, const Score &s, const unsigned utterances)
+{
+	std::cout << label
+		<< "\tSLOPE=" << std::sqrt(s.slope/s.targets)
+		<< "\tOFFSET=" << std::sqrt(s.offset/s.targets)
+		<< "\tTAU=" << std::sqrt(s.tau/s.targets)
+		<< "\tONSET=" << std::sqrt(s.onset/utterances)
+		<< "\tF0=" << std::sqrt(s.f0/s.samples) << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// ********** command line parsing **********
+		dlib::command_line_parser parser;
+		parser.add_option("h","Display this help message.");
+		parser.add_option("l","Read truth/result csv pairs (tab separated) from given list file.",1);
+		parser.add_option("v","Print score of each utterance.");
+		parser.add_option("rate","Specify sampling rate of the contour comparison in Hz.",1);
+		parser.parse(argc,argv);
+
+		const char* one_time_opts[] = {"h", "l", "v", "rate"};
+		parser.check_one_time_options(one_time_opts);
+		parser.check_option_arg_range("rate", 1.0, 1e6);
+
+		if (parser.option("h"))
+		{
+			std::cout << "Usage: TargetOptimizerScore { <truth-csv> <result-csv> | -l <list-file> } { <options> }\n";
+			std::cout << "Prints root mean square errors of recovered targets and model f0 against ground truth.\n";
+			parser.print_options();
+			return EXIT_SUCCESS;
+		}
+
+		// collect pairs of files
+		std::vector<std::pair<std::string,std::string> > pairs;
+		if (parser.option("l"))
+		{
+			std::ifstream fin (parser.option("l").argument().c_str());
+			if (!fin.good())
+			{
+				throw dlib::error("[main] List file not found!");
+			}
+			std::string line;
+			while (std::getline(fin, line))
+			{
+				std::vector<std::string> tokens = dlib::split(line, "\t");
+				if (tokens.size() == 2)
+				{
+					pairs.push_back(std::make_pair(tokens[0], tokens[1]));
+				}
+			}
+		}
+		else if (parser.number_of_arguments() == 2)
+		{
+			pairs.push_back(std::make_pair(parser[0], parser[1]));
+		}
+		else
+		{
+			std::cout << "Error in command line:\n   You must specify two csv files or a list file.\n";
+			std::cout << "\nTry the -h option for more information." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		// accumulate over all utterances, missing results are counted separately
+		const double samplingPeriod = 1.0/get_option(parser,"rate",200.0);
+		Score total = {0.0, 0.0, 0.0, 0.0, 0.0, 0, 0};
+		unsigned scored (0), missing (0);
+		for (unsigned i=0; i<pairs.size(); ++i)
+		{
+			if (!std::ifstream(pairs[i].second.c_str()).good())
+			{
+				missing++;
+				continue;
+			}
+
+			Score s = compare(pairs[i].first, pairs[i].second, samplingPeriod);
+			if (parser.option("v"))
+			{
+				printScore(pairs[i].second, s, 1);
+			}
+			total.slope += s.slope;
+			total.offset += s.offset;
+			total.tau += s.tau;
+			total.onset += s.onset;
+			total.f0 += s.f0;
+			total.targets += s.targets;
+			total.samples += s.samples;
+			scored++;
+		}
+
+		if (scored == 0)
+		{
+			throw dlib::error("[main] No results found!");
+		}
+
+		std::cout << "Scored " << scored << " utterances, " << missing << " results missing." << std::endl;
+		printScore("Total", total, scored);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "[main] Program was terminated because an error occurred!\n" << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+#include <math.h>
+#include <limits>
+#include <dlib/threads.h>
+#include "sweep.h"
+
+// solves contiguous parts of the grid, parts may be called from several threads
+class SweepRunner {
+public:
+	SweepRunner (const ParameterSweep &sweep, const std::vector<ParameterSet> &grid, const unsigned parts, std::vector<SweepPoint> &points)
+		: m_sweep(sweep), m_grid(grid), m_parts(parts), m_points(points) {}
+
+	void run (long part)
+	{
+		const unsigned begin = part*m_grid.size()/m_parts;
+		const unsigned end = (part+1)*m_grid.size()/m_parts;
+		m_sweep.solvePath(m_grid, begin, end, m_sweep.m_seed + part, m_points);
+	}
+
+private:
+	const ParameterSweep &m_sweep;
+	const std::vector<ParameterSet> &m_grid;
+	const unsigned m_parts;
+	std::vector<SweepPoint> &m_points; // each part writes its own range
+};
+
+ParameterSweep::ParameterSweep (const TimeSignal &f0, const BoundVector &bounds)
+	: m_f0(f0), m_bounds(bounds), m_threads(1), m_folds(5), m_restarts(0), m_seed(time(NULL))
+{
+	if (m_bounds.size() < 3)
+	{
+		throw dlib::error("[ParameterSweep] Cross-validation needs at least two syllables!");
+	}
+
+	// assign samples to syllables like the filter does, samples outside of the bounds are always used for training
+	for (unsigned k=0; k<m_f0.size(); ++k)
+	{
+		const double t = m_f0[k].time;
+		int syllable (-1);
+		if (t >= m_bounds.front() && t <= m_bounds.back())
+		{
+			syllable = 0;
+			while (t > m_bounds[syllable+1] && syllable+2 < (int)m_bounds.size())
+			{
+				syllable++;
+			}
+		}
+		m_syllables.push_back(syllable);
+	}
+}
+
+void ParameterSweep::setThreads(const unsigned threads)
+{
+	m_threads = std::max(threads, 1u);
+}
+
+void ParameterSweep::setFolds(const unsigned folds)
+{
+	m_folds = std::max(folds, 2u);
+}
+
+void ParameterSweep::setRestarts(const unsigned restarts)
+{
+	m_restarts = restarts;
+}
+
+void ParameterSweep::setSeed(const unsigned long seed)
+{
+	m_seed = seed;
+}
+
+std::vector<SweepPoint> ParameterSweep::run(const std::vector<ParameterSet> &grid) const
+{
+	std::vector<SweepPoint> points (grid.size());
+	if (grid.empty())
+	{
+		return points;
+	}
+
+	// each part pays one global search, so use no more parts than threads
+	const unsigned parts = std::min<unsigned>(m_threads, grid.size());
+	SweepRunner runner (*this, grid, parts, points);
+	if (parts > 1)
+	{
+		dlib::parallel_for(parts, 0, parts, runner, &SweepRunner::run, 1);
+	}
+	else
+	{
+		runner.run(0);
+	}
+
+	return points;
+}
+
+std::vector<ParameterSet> ParameterSweep::makeGrid(const ParameterSet &base, const std::string &parameter, const std::vector<double> &values)
+{
+	std::vector<ParameterSet> grid;
+	for (unsigned i=0; i<values.size(); ++i)
+	{
+		ParameterSet ps = base;
+		if (parameter == "lambda")
+			ps.lambda = values[i];
+		else if (parameter == "m-weight")
+			ps.weightSlope = values[i];
+		else if (parameter == "b-weight")
+			ps.weightOffset = values[i];
+		else if (parameter == "t-weight")
+			ps.weightTau = values[i];
+		else
+			throw dlib::error("[makeGrid] Unknown sweep parameter: " + parameter);
+		grid.push_back(ps);
+	}
+	return grid;
+}
+
+unsigned ParameterSweep::selectBest(const std::vector<SweepPoint> &points)
+{
+	unsigned best (0);
+	for (unsigned i=1; i<points.size(); ++i)
+	{
+		if (points[i].heldOutRmse < points[best].heldOutRmse)
+		{
+			best = i;
+		}
+	}
+	return best;
+}
+
+void ParameterSweep::solvePath(const std::vector<ParameterSet> &grid, const unsigned begin, const unsigned end, const unsigned long seed, std::vector<SweepPoint> &points) const
+{
+	BobyqaOptimizer optimizer;
+	optimizer.setSeed(seed);
+	optimizer.setRestarts(m_restarts);
+
+	for (unsigned g=begin; g<end; ++g)
+	{
+		SweepPoint &point = points[g];
+		point.parameters = grid[g];
+
+		// global search for the first point, then continue from the neighbouring solution
+		OptimizationProblem problem (grid[g], m_f0, m_bounds);
+		if (g == begin)
+		{
+			point.report = optimizer.optimize(problem);
+		}
+		else
+		{
+			problem.setOptimum(points[g-1].solution.onset, points[g-1].solution.targets);
+			point.report = optimizer.polish(problem);
+		}
+
+		point.solution.onset = problem.getOnset().value;
+		point.solution.targets = problem.getPitchTargets();
+		point.metrics = problem.getFitMetrics();
+		point.heldOutRmse = crossValidate(grid[g], point.solution, optimizer, point.report);
+	}
+}
+
+double ParameterSweep::crossValidate(const ParameterSet &parameters, const ModelSolution &solution, const BobyqaOptimizer &optimizer, OptimizationReport &report) const
+{
+	const unsigned numTargets = solution.targets.size();
+	const unsigned folds = std::min(m_folds, numTargets);
+
+	// interleaved folds, so held-out syllables lie between training syllables
+	double squaredError (0.0);
+	unsigned heldOut (0);
+	for (unsigned fold=0; fold<folds; ++fold)
+	{
+		TimeSignal train;
+		SampleTimes testTimes;
+		std::vector<double> testValues;
+		for (unsigned k=0; k<m_f0.size(); ++k)
+		{
+			if (m_syllables[k] >= 0 && m_syllables[k] % folds == fold)
+			{
+				testTimes.push_back(m_f0[k].time);
+				testValues.push_back(m_f0[k].value);
+			}
+			else
+			{
+				train.push_back(m_f0[k]);
+			}
+		}
+		if (testTimes.empty() || train.empty())
+			continue;
+
+		// held-out targets restart from the prior, as the full solution has seen their samples
+		TargetVector targets = solution.targets;
+		for (unsigned i=fold; i<numTargets; i+=folds)
+		{
+			targets[i].slope = parameters.meanSlope;
+			targets[i].offset = parameters.meanOffset;
+			targets[i].tau = parameters.meanTau;
+		}
+
+		OptimizationProblem problem (parameters, train, m_bounds);
+		problem.setOptimum(solution.onset, targets);
+		OptimizationReport r = optimizer.polish(problem);
+		report.restarts += r.restarts;
+		report.evaluations += r.evaluations;
+
+		TamModelF0 model (m_bounds);
+		model.setOnsetValue(problem.getOnset().value);
+		model.setPitchTargets(problem.getPitchTargets());
+		TimeSignal predicted = model.calculateF0(testTimes);
+		for (unsigned k=0; k<predicted.size() && k<testValues.size(); ++k)
+		{
+			squaredError += std::pow(predicted[k].value - testValues[k], 2.0);
+			heldOut++;
+		}
+	}
+
+	// without held-out samples the point cannot be scored
+	return (heldOut > 0) ? std::sqrt(squaredError/heldOut) : std::numeric_limits<double>::infinity();
+}
@@ -0,0 +1,125 @@
+#include <math.h>
+#include <algorithm>
+#include "synthesis.h"
+
+CorpusSettings defaultCorpusSettings()
+{
+	CorpusSettings s;
+	s.minSyllables = 2;
+	s.maxSyllables = 10;
+	s.minDuration = 0.1;
+	s.maxDuration = 0.3;
+	s.leadIn = 0.1;
+	s.minBase = 80.0;
+	s.maxBase = 95.0;
+	s.slopeRange = 30.0;
+	s.offsetRange = 6.0;
+	s.minTau = 10.0;
+	s.maxTau = 20.0;
+	s.rate = 100.0;
+	s.noise = 0.0;
+	s.jitter = 0.0;
+	s.dropout = 0.0;
+	s.gapProbability = 0.0;
+	s.gapDuration = 0.05;
+	return s;
+}
+
+CorpusGenerator::CorpusGenerator (const CorpusSettings &settings, const unsigned long seed)
+	: m_settings(settings), m_random(seed)
+{
+	if (settings.minSyllables < 1 || settings.maxSyllables < settings.minSyllables)
+	{
+		throw dlib::error("[CorpusGenerator] Invalid number of syllables!");
+	}
+	if (settings.minDuration <= 0.0 || settings.maxDuration < settings.minDuration || settings.rate <= 0.0 || settings.minTau <= 0.0 || settings.jitter < 0.0 || settings.jitter >= 1.0)
+	{
+		throw dlib::error("[CorpusGenerator] Invalid corpus settings!");
+	}
+}
+
+SyntheticUtterance CorpusGenerator::generate()
+{
+	unsigned range = m_settings.maxSyllables - m_settings.minSyllables + 1;
+	return generate(m_settings.minSyllables + m_random.get_random_32bit_number()%range);
+}
+
+SyntheticUtterance CorpusGenerator::generate(const unsigned syllables)
+{
+	const CorpusSettings &s = m_settings;
+	SyntheticUtterance u;
+
+	// random targets around the utterance mean pitch
+	double base = uniform(s.minBase, s.maxBase);
+	u.onset.time = s.leadIn;
+	u.onset.value = base + uniform(-s.offsetRange, s.offsetRange);
+	u.bounds.push_back(s.leadIn);
+	for (unsigned i=0; i<syllables; ++i)
+	{
+		PitchTarget pt;
+		pt.slope = uniform(-s.slopeRange, s.slopeRange);
+		pt.offset = base + uniform(-s.offsetRange, s.offsetRange);
+		pt.tau = uniform(s.minTau, s.maxTau);
+		pt.duration = uniform(s.minDuration, s.maxDuration);
+		u.targets.push_back(pt);
+		u.bounds.push_back(u.bounds.back() + pt.duration);
+	}
+
+	// unvoiced gaps, at most one per syllable
+	std::vector<double> gapBegin, gapEnd;
+	for (unsigned i=0; i<syllables; ++i)
+	{
+		if (m_random.get_random_double() < s.gapProbability)
+		{
+			double length = uniform(0.0, std::min(s.gapDuration, u.targets[i].duration));
+			double begin = uniform(u.bounds[i], u.bounds[i+1]-length);
+			gapBegin.push_back(begin);
+			gapEnd.push_back(begin+length);
+		}
+	}
+
+	// sample times: jittered grid without dropouts and gaps
+	const double period = 1.0/s.rate;
+	SampleTimes times;
+	unsigned gap (0);
+	for (unsigned k=0; s.leadIn+k*period<=u.bounds.back(); ++k)
+	{
+		double time = s.leadIn + k*period;
+		if (k > 0 && s.jitter > 0.0)
+		{
+			time += uniform(-0.5*s.jitter, 0.5*s.jitter)*period;
+			time = std::min(time, u.bounds.back());
+		}
+
+		while (gap < gapEnd.size() && gapEnd[gap] < time)
+		{
+			gap++;
+		}
+		if (gap < gapBegin.size() && gapBegin[gap] <= time)
+		{
+			continue;
+		}
+		if (s.dropout > 0.0 && m_random.get_random_double() < s.dropout)
+		{
+			continue;
+		}
+		times.push_back(time);
+	}
+
+	// render and degrade
+	TamModelF0 model (u.bounds);
+	model.setOnsetValue(u.onset.value);
+	model.setPitchTargets(u.targets);
+	u.f0 = model.calculateF0(times);
+	for (unsigned k=0; s.noise > 0.0 && k<u.f0.size(); ++k)
+	{
+		u.f0[k].value += s.noise*m_random.get_random_gaussian();
+	}
+
+	return u;
+}
+
+double CorpusGenerator::uniform(const double min, const double max)
+{
+	return min + m_random.get_random_double()*(max-min);
+}
@@ -0,0 +1,250 @@
+#include <string>
+#include <exception>
+#include "model.h"
+#include "targetoptimizer.h"
+
+struct to_problem
+{
+	to_problem (const ParameterSet &parameters, const TimeSignal &f0, const BoundVector &bounds)
+		: problem(parameters, f0, bounds), optimized(false) {};
+
+	OptimizationProblem problem;
+	bool optimized;
+	OptimizationReport report;
+	std::string error;
+};
+
+static ParameterSet convertParameters (const to_parameters *p)
+{
+	ParameterSet ps;
+	ps.deltaSlope = p->deltaSlope;
+	ps.deltaOffset = p->deltaOffset;
+	ps.deltaTau = p->deltaTau;
+	ps.weightSlope = p->weightSlope;
+	ps.weightOffset = p->weightOffset;
+	ps.weightTau = p->weightTau;
+	ps.meanSlope = p->meanSlope;
+	ps.meanOffset = p->meanOffset;
+	ps.meanTau = p->meanTau;
+	ps.lambda = p->lambda;
+	return ps;
+}
+
+static bool isAscending (const double *values, size_t size)
+{
+	for (size_t i=1; i<size; ++i)
+	{
+		if (!(values[i] > values[i-1]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+extern "C" {
+
+void to_default_parameters(to_parameters *parameters, const double *f0Values, size_t numSamples)
+{
+	if (parameters == 0)
+	{
+		return;
+	}
+
+	double meanF0 (0.0);
+	for (size_t i=0; f0Values != 0 && i<numSamples; ++i)
+	{
+		meanF0 += f0Values[i];
+	}
+	meanF0 = (numSamples > 0) ? meanF0/numSamples : 0.0;
+
+	parameters->deltaSlope = 50.0;
+	parameters->deltaOffset = 20.0;
+	parameters->deltaTau = 5.0;
+	parameters->weightSlope = 10.0;
+	parameters->weightOffset = 5.0;
+	parameters->weightTau = 1.0;
+	parameters->meanSlope = 0.0;
+	parameters->meanOffset = meanF0;
+	parameters->meanTau = 15.0;
+	parameters->lambda = 0.0;
+}
+
+int to_create(const to_parameters *parameters, const double *bounds, size_t numBounds, const double *f0Times, const double *f0Values, size_t numSamples, to_problem **problem)
+{
+	if (problem == 0)
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+	*problem = 0;
+
+	if (parameters == 0 || bounds == 0 || f0Times == 0 || f0Values == 0 || numBounds < 2 || numSamples == 0)
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+	if (!isAscending(bounds, numBounds) || !isAscending(f0Times, numSamples))
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+
+	try
+	{
+		BoundVector bv (bounds, bounds+numBounds);
+		TimeSignal f0;
+		for (size_t i=0; i<numSamples; ++i)
+		{
+			Sample s = {f0Times[i], f0Values[i]};
+			f0.push_back(s);
+		}
+		*problem = new to_problem(convertParameters(parameters), f0, bv);
+	}
+	catch (std::exception&)
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+
+	return TO_OK;
+}
+
+void to_destroy(to_problem *problem)
+{
+	delete problem;
+}
+
+int to_optimize(to_problem *problem, const to_settings *settings)
+{
+	if (problem == 0)
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+
+	problem->error.clear();
+	try
+	{
+		BobyqaOptimizer optimizer;
+		if (settings != 0)
+		{
+			optimizer.setThreads(settings->threads);
+			optimizer.setTimeBudget(settings->timeBudget);
+			if (settings->seed != 0)
+			{
+				optimizer.setSeed(settings->seed);
+			}
+		}
+		problem->report = optimizer.optimize(problem->problem);
+		problem->optimized = true;
+	}
+	catch (std::exception& e)
+	{
+		problem->error = e.what();
+		return TO_ERROR_OPTIMIZATION;
+	}
+
+	return TO_OK;
+}
+
+int to_get_result(const to_problem *problem, double *onset, to_target *targets, size_t capacity, to_metrics *metrics)
+{
+	if (problem == 0)
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+	if (!problem->optimized)
+	{
+		return TO_ERROR_STATE;
+	}
+
+	TargetVector optTargets = problem->problem.getPitchTargets();
+	if (targets != 0 && capacity < optTargets.size())
+	{
+		return TO_ERROR_BUFFER;
+	}
+
+	if (onset != 0)
+	{
+		*onset = problem->problem.getOnset().value;
+	}
+
+	for (size_t i=0; targets != 0 && i<optTargets.size(); ++i)
+	{
+		targets[i].slope = optTargets[i].slope;
+		targets[i].offset = optTargets[i].offset;
+		targets[i].tau = optTargets[i].tau;
+		targets[i].duration = optTargets[i].duration;
+	}
+
+	if (metrics != 0)
+	{
+		FitMetrics m = problem->problem.getFitMetrics();
+		metrics->rmse = m.rmse;
+		metrics->correlation = m.correlation;
+		metrics->maxError = m.maxError;
+		metrics->squaredError = m.squaredError;
+		metrics->penalty = m.penalty;
+		metrics->restarts = problem->report.restarts;
+		metrics->truncated = problem->report.truncated ? 1 : 0;
+	}
+
+	return TO_OK;
+}
+
+const char* to_last_error(const to_problem *problem)
+{
+	return (problem != 0) ? problem->error.c_str() : "";
+}
+
+int to_evaluate_model(double begin, double onset, const to_target *targets, size_t numTargets, const double *times, double *values, size_t numSamples)
+{
+	if (targets == 0 || numTargets == 0 || (numSamples > 0 && (times == 0 || values == 0)))
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+
+	// targets define the syllable bounds
+	BoundVector bounds (1, begin);
+	TargetVector tv;
+	for (size_t i=0; i<numTargets; ++i)
+	{
+		if (!(targets[i].duration > 0.0) || !(targets[i].tau > 0.0))
+		{
+			return TO_ERROR_ARGUMENT;
+		}
+		PitchTarget pt = {targets[i].slope, targets[i].offset, targets[i].tau, targets[i].duration};
+		tv.push_back(pt);
+		bounds.push_back(bounds.back() + pt.duration);
+	}
+
+	// samples have to lie inside the modelled range
+	if (numSamples == 0)
+	{
+		return TO_OK;
+	}
+	if (!isAscending(times, numSamples) || times[0] < begin || times[numSamples-1] > bounds.back())
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+
+	try
+	{
+		TamModelF0 model (bounds);
+		model.setOnsetValue(onset);
+		model.setPitchTargets(tv);
+		TimeSignal f0 = model.calculateF0(SampleTimes(times, times+numSamples));
+		if (f0.size() != numSamples)
+		{
+			return TO_ERROR_ARGUMENT;
+		}
+		for (size_t k=0; k<numSamples; ++k)
+		{
+			values[k] = f0[k].value;
+		}
+	}
+	catch (std::exception&)
+	{
+		return TO_ERROR_ARGUMENT;
+	}
+
+	return TO_OK;
+}
+
+}
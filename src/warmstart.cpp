@@ -0,0 +1,260 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <math.h>
+#include "warmstart.h"
+
+WarmStartStore::WarmStartStore (const std::string &storeFile, const unsigned maxEntries)
+	: m_file(storeFile), m_maxEntries(maxEntries)
+{
+	load();
+}
+
+void WarmStartStore::addSolution(const std::string &speaker, const std::string &context, const double meanF0, const ModelSolution &solution)
+{
+	dlib::auto_mutex lock(m_mutex);
+	if (solution.targets.empty())
+	{
+		return;
+	}
+
+	Entry entry;
+	entry.speaker = sanitize(speaker);
+	entry.context = sanitize(context);
+	entry.onset = solution.onset - meanF0;
+	entry.targets = solution.targets;
+	for (unsigned i=0; i<entry.targets.size(); ++i)
+	{
+		entry.targets[i].offset -= meanF0;
+	}
+
+	// a new solution of the same utterance shape replaces the old one
+	std::vector<double> shape = relativeDurations(entry.targets);
+	for (unsigned k=0; k<m_entries.size(); ++k)
+	{
+		const Entry &e = m_entries[k];
+		if (e.speaker == entry.speaker && e.context == entry.context && e.targets.size() == entry.targets.size() && shapeDistance(shape, relativeDurations(e.targets)) < 1e-3)
+		{
+			m_entries.erase(m_entries.begin()+k);
+			break;
+		}
+	}
+
+	m_entries.push_back(entry);
+	if (m_entries.size() > m_maxEntries)
+	{
+		m_entries.erase(m_entries.begin(), m_entries.begin() + (m_entries.size()-m_maxEntries));
+	}
+}
+
+std::vector<ModelSolution> WarmStartStore::findNearest(const std::string &speaker, const std::string &context, const double meanF0, const BoundVector &bounds, const unsigned count) const
+{
+	dlib::auto_mutex lock(m_mutex);
+	std::vector<ModelSolution> solutions;
+	if (bounds.size() < 2 || count == 0)
+	{
+		return solutions;
+	}
+
+	TargetVector durations;
+	for (unsigned i=0; i+1<bounds.size(); ++i)
+	{
+		PitchTarget pt = {0.0, 0.0, 0.0, bounds[i+1]-bounds[i]};
+		durations.push_back(pt);
+	}
+	std::vector<double> shape = relativeDurations(durations);
+
+	// matching speaker ranks before matching context, then nearest shape
+	const std::string spk = sanitize(speaker);
+	const std::string ctx = sanitize(context);
+	std::vector<std::pair<double,unsigned> > ranking;
+	for (unsigned k=0; k<m_entries.size(); ++k)
+	{
+		const Entry &e = m_entries[k];
+		double tier = (e.speaker == spk ? 0.0 : 2.0) + (e.context == ctx ? 0.0 : 1.0);
+		ranking.push_back(std::make_pair(10.0*tier + shapeDistance(shape, relativeDurations(e.targets)), k));
+	}
+	std::sort(ranking.begin(), ranking.end());
+
+	for (unsigned r=0; r<ranking.size() && solutions.size()<count; ++r)
+	{
+		solutions.push_back(mapToBounds(m_entries[ranking[r].second], meanF0, bounds));
+	}
+
+	return solutions;
+}
+
+void WarmStartStore::save() const
+{
+	dlib::auto_mutex lock(m_mutex);
+	// write to a temporary file first, so readers never see a partial store
+	std::string tmpFile = m_file + ".tmp";
+	{
+		std::ofstream fout (tmpFile.c_str());
+		if (!fout.good())
+		{
+			throw dlib::error("[save] Warm start file cannot be written!");
+		}
+		fout.precision(10);
+
+		// one solution per line: speaker, context, onset, targets (slope offset tau duration)
+		for (unsigned k=0; k<m_entries.size(); ++k)
+		{
+			const Entry &e = m_entries[k];
+			fout << e.speaker << "\t" << e.context << "\t" << e.onset;
+			for (unsigned i=0; i<e.targets.size(); ++i)
+			{
+				fout << "\t" << e.targets[i].slope << " " << e.targets[i].offset << " " << e.targets[i].tau << " " << e.targets[i].duration;
+			}
+			fout << "\n";
+		}
+		if (!fout.good())
+		{
+			throw dlib::error("[save] Warm start file cannot be written!");
+		}
+	}
+
+	if (std::rename(tmpFile.c_str(), m_file.c_str()) != 0)
+	{
+		throw dlib::error("[save] Warm start file cannot be replaced!");
+	}
+}
+
+unsigned WarmStartStore::size() const
+{
+	dlib::auto_mutex lock(m_mutex);
+	return m_entries.size();
+}
+
+void WarmStartStore::load()
+{
+	std::ifstream fin (m_file.c_str());
+	if (!fin.good())
+	{
+		return;	// new store
+	}
+
+	// malformed lines are skipped, the store is only a source of start points
+	std::string line;
+	while (std::getline(fin, line))
+	{
+		std::vector<std::string> fields;
+		std::istringstream ls (line);
+		std::string field;
+		while (std::getline(ls, field, '\t'))
+		{
+			fields.push_back(field);
+		}
+		if (fields.size() < 4)
+			continue;
+
+		Entry e;
+		e.speaker = fields[0];
+		e.context = fields[1];
+		e.onset = atof(fields[2].c_str());
+		bool valid (true);
+		for (unsigned i=3; i<fields.size(); ++i)
+		{
+			std::istringstream ts (fields[i]);
+			PitchTarget pt;
+			if (!(ts >> pt.slope >> pt.offset >> pt.tau >> pt.duration) || pt.duration <= 0.0)
+			{
+				valid = false;
+				break;
+			}
+			e.targets.push_back(pt);
+		}
+
+		if (valid)
+		{
+			m_entries.push_back(e);
+		}
+	}
+
+	if (m_entries.size() > m_maxEntries)
+	{
+		m_entries.erase(m_entries.begin(), m_entries.begin() + (m_entries.size()-m_maxEntries));
+	}
+}
+
+std::vector<double> WarmStartStore::relativeDurations(const TargetVector &targets)
+{
+	double total (0.0);
+	for (unsigned i=0; i<targets.size(); ++i)
+	{
+		total += targets[i].duration;
+	}
+
+	std::vector<double> rel;
+	for (unsigned i=0; i<targets.size(); ++i)
+	{
+		rel.push_back(targets[i].duration/total);
+	}
+	return rel;
+}
+
+double WarmStartStore::shapeDistance(const std::vector<double> &a, const std::vector<double> &b)
+{
+	// difference in syllable count plus mean distance of interior bounds to the nearest other bound
+	double d = std::fabs((double)a.size()-(double)b.size()) / std::max(a.size(), b.size());
+
+	std::vector<double> qb;
+	double q (0.0);
+	for (unsigned j=0; j+1<b.size(); ++j)
+	{
+		q += b[j];
+		qb.push_back(q);
+	}
+
+	double sum (0.0);
+	q = 0.0;
+	for (unsigned i=0; i+1<a.size(); ++i)
+	{
+		q += a[i];
+		double nearest (1.0);
+		for (unsigned j=0; j<qb.size(); ++j)
+		{
+			nearest = std::min(nearest, std::fabs(q-qb[j]));
+		}
+		sum += nearest;
+	}
+
+	return (a.size() > 1) ? d + sum/(a.size()-1) : d;
+}
+
+ModelSolution WarmStartStore::mapToBounds(const Entry &entry, const double meanF0, const BoundVector &bounds)
+{
+	// each new syllable takes the stored target at its relative midpoint
+	std::vector<double> rel = relativeDurations(entry.targets);
+	const double total = bounds.back()-bounds.front();
+
+	ModelSolution sol;
+	sol.onset = entry.onset + meanF0;
+	for (unsigned i=0; i+1<bounds.size(); ++i)
+	{
+		double mid = (0.5*(bounds[i]+bounds[i+1]) - bounds.front())/total;
+		unsigned j (0);
+		double q = rel[0];
+		while (j+1 < rel.size() && q < mid)
+		{
+			q += rel[++j];
+		}
+
+		PitchTarget pt = entry.targets[j];
+		pt.offset += meanF0;
+		pt.duration = bounds[i+1]-bounds[i];
+		sol.targets.push_back(pt);
+	}
+
+	return sol;
+}
+
+std::string WarmStartStore::sanitize(const std::string &key)
+{
+	std::string s (key);
+	std::replace(s.begin(), s.end(), '\t', ' ');
+	std::replace(s.begin(), s.end(), '\n', ' ');
+	std::replace(s.begin(), s.end(), '\r', ' ');
+	return s;
+}
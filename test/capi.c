@@ -0,0 +1,84 @@
+/*
+ * Example caller of the C interface and its test: fits targets to the
+ * contour of known targets, then checks the result and the error codes.
+ * Exits with nonzero status on the first failed check.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "targetoptimizer.h"
+
+#define NUM_TARGETS 3
+#define NUM_SAMPLES 60
+
+static int check(int condition, const char *message)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "C API test failed: %s\n", message);
+	}
+	return condition;
+}
+
+int main(void)
+{
+	const to_target original[NUM_TARGETS] = {
+		{-10.0, 90.0, 12.0, 0.2},
+		{20.0, 94.0, 15.0, 0.2},
+		{-30.0, 88.0, 10.0, 0.2}
+	};
+	double bounds[NUM_TARGETS+1] = {0.0, 0.2, 0.4, 0.6};
+	double times[NUM_SAMPLES];
+	double values[NUM_SAMPLES];
+	to_parameters parameters;
+	to_settings settings = {1, 0.0, 1};
+	to_problem *problem = 0;
+	to_target targets[NUM_TARGETS];
+	to_metrics metrics;
+	double onset;
+	size_t k;
+
+	/* contour of known targets */
+	for (k=0; k<NUM_SAMPLES; ++k)
+	{
+		times[k] = 0.005 + 0.01*k;
+	}
+	if (!check(to_evaluate_model(0.0, 88.0, original, NUM_TARGETS, times, values, NUM_SAMPLES) == TO_OK, "model evaluation"))
+		return 1;
+
+	to_default_parameters(&parameters, values, NUM_SAMPLES);
+	if (!check(to_create(&parameters, bounds, NUM_TARGETS+1, times, values, NUM_SAMPLES, &problem) == TO_OK, "create"))
+		return 1;
+	if (!check(to_get_result(problem, &onset, targets, NUM_TARGETS, &metrics) == TO_ERROR_STATE, "result before optimization"))
+		return 1;
+
+	/* unlimited optimization fits the contour */
+	if (!check(to_optimize(problem, &settings) == TO_OK, to_last_error(problem)))
+		return 1;
+	if (!check(to_get_result(problem, &onset, targets, NUM_TARGETS-1, 0) == TO_ERROR_BUFFER, "small target buffer"))
+		return 1;
+	if (!check(to_get_result(problem, &onset, targets, NUM_TARGETS, &metrics) == TO_OK, "result"))
+		return 1;
+	if (!check(metrics.rmse < 0.1 && metrics.restarts > 0 && !metrics.truncated, "fit of known targets"))
+		return 1;
+	for (k=0; k<NUM_TARGETS; ++k)
+	{
+		if (!check(fabs(targets[k].duration - original[k].duration) < 1e-9, "target durations"))
+			return 1;
+	}
+
+	/* a tiny time budget cuts the optimization short */
+	settings.timeBudget = 1e-6;
+	if (!check(to_optimize(problem, &settings) == TO_OK, to_last_error(problem)))
+		return 1;
+	if (!check(to_get_result(problem, 0, 0, 0, &metrics) == TO_OK && metrics.truncated, "truncation by time budget"))
+		return 1;
+
+	to_destroy(problem);
+
+	if (!check(to_create(&parameters, bounds, 1, times, values, NUM_SAMPLES, &problem) == TO_ERROR_ARGUMENT && problem == 0, "invalid bounds"))
+		return 1;
+
+	printf("C API test passed (version %d).\n", TO_API_VERSION);
+	return 0;
+}